@@ -0,0 +1,3 @@
+-- pgbench -n -f bench/checkpoint.sql: keep rewriting pg_control, so that
+-- readers of pg_controldata cannot trust its mtime and must re-read it.
+CHECKPOINT;
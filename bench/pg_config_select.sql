@@ -0,0 +1,3 @@
+-- pgbench -n -f bench/pg_config_select.sql: one scan of the pg_config view
+-- per transaction, to measure the per-row cost of building the result.
+SELECT * FROM pg_config;
@@ -0,0 +1,3 @@
+-- pgbench -n -f bench/pg_controldata_select.sql: one read of the
+-- pg_controldata view per transaction.
+SELECT * FROM pg_controldata;
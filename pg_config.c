@@ -27,6 +27,8 @@
 
 #include "postgres.h"
 
+#include <ctype.h>
+#include <limits.h>
 #include <unistd.h>
 #include <time.h>
 #include <sys/stat.h>
@@ -34,13 +36,41 @@
 
 #include "funcapi.h"
 #include "miscadmin.h"
-#include "catalog/pg_control.h"
 #include "catalog/pg_type.h"
+#include "lib/stringinfo.h"
+#include "libpq/md5.h"
 #include "port.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+
+#include "pg_config_int.h"
 
 static void cleanup_path(char *path);
 static void get_configdata(void);
+static Datum pg_config_percall(FunctionCallInfo fcinfo);
+static HeapTuple get_configtuple(int i, TupleDesc tupdesc);
+static text *setting_text(int i);
+static void compute_configdata(void);
+static const char *compute_setting(int i);
+static MemoryContext get_configdata_context(void);
+static int	lookup_configdata(const char *name);
+static void sort_configdata(void);
+static int	configdata_name_cmp(const void *a, const void *b);
+static void load_shared_configdata(void);
+static Size pack_configdata(char *dst, Size dstsize);
+static Size pgc_memsize(void);
+static void pgc_shmem_startup(void);
 static size_t conf_strlcat(char *dst, const char *src, size_t siz);
+static void compute_fingerprints(void);
+static void fingerprint_category(const char *category, char *hexsum);
+static void serialize_json(char *dst, Size *len);
+
+void _PG_init(void);
+void _PG_fini(void);
 
 #ifdef PGDLLIMPORT
 /* Postgres global */
@@ -53,43 +83,260 @@ extern DLLIMPORT char my_exec_path[];
 
 PG_MODULE_MAGIC;
 
+/*
+ * Build settings the Makefile did not pass in are reported as such.
+ */
+#ifndef VAL_CONFIGURE
+#define VAL_CONFIGURE "not recorded"
+#endif
+#ifndef VAL_CC
+#define VAL_CC "not recorded"
+#endif
+#ifndef VAL_CPPFLAGS
+#define VAL_CPPFLAGS "not recorded"
+#endif
+#ifndef VAL_CFLAGS
+#define VAL_CFLAGS "not recorded"
+#endif
+#ifndef VAL_CFLAGS_SL
+#define VAL_CFLAGS_SL "not recorded"
+#endif
+#ifndef VAL_LDFLAGS
+#define VAL_LDFLAGS "not recorded"
+#endif
+#ifndef VAL_LDFLAGS_SL
+#define VAL_LDFLAGS_SL "not recorded"
+#endif
+#ifndef VAL_LIBS
+#define VAL_LIBS "not recorded"
+#endif
+
+/*
+ * value and valuelen are set for settings fixed at build time; the rest
+ * are installation paths resolved at run time by compute_setting().
+ * category groups the settings for pg_config_fingerprint().
+ */
 struct configdata
 {
-	char	   *name;
-	char	   *setting;
+	const char *name;
+	const char *category;
+	const char *value;			/* build-time setting, or NULL */
+	int			valuelen;		/* strlen(value) */
+	const char *setting;
+	HeapTuple	tuple;			/* cached (name, setting) row, or NULL */
 };
 
+#define CONFIGDATA_PATH(name)	{name, "paths", NULL, 0, NULL, NULL}
+#define CONFIGDATA_BUILTIN(name, category, value) \
+	{name, category, value, sizeof(value) - 1, NULL, NULL}
+
 static struct configdata ConfigData[] =
 {
-	{"BINDIR", NULL},
-	{"DOCDIR", NULL},
-	{"HTMLDIR", NULL},
-	{"INCLUDEDIR", NULL},
-	{"PKGINCLUDEDIR", NULL},
-	{"INCLUDEDIR-SERVER", NULL},
-	{"LIBDIR", NULL},
-	{"PKGLIBDIR", NULL},
-	{"LOCALEDIR", NULL},
-	{"MANDIR", NULL},
-	{"SHAREDIR", NULL},
-	{"SYSCONFDIR", NULL},
-	{"PGXS", NULL},
-	{"CONFIGURE", NULL},
-	{"CC", NULL},
-	{"CPPFLAGS", NULL},
-	{"CFLAGS", NULL},
-	{"CFLAGS_SL", NULL},
-	{"LDFLAGS", NULL},
-	{"LDFLAGS_SL", NULL},
-	{"LIBS", NULL},
-	{"VERSION", NULL},
-	{NULL, NULL}
+	CONFIGDATA_PATH("BINDIR"),
+	CONFIGDATA_PATH("DOCDIR"),
+	CONFIGDATA_PATH("HTMLDIR"),
+	CONFIGDATA_PATH("INCLUDEDIR"),
+	CONFIGDATA_PATH("PKGINCLUDEDIR"),
+	CONFIGDATA_PATH("INCLUDEDIR-SERVER"),
+	CONFIGDATA_PATH("LIBDIR"),
+	CONFIGDATA_PATH("PKGLIBDIR"),
+	CONFIGDATA_PATH("LOCALEDIR"),
+	CONFIGDATA_PATH("MANDIR"),
+	CONFIGDATA_PATH("SHAREDIR"),
+	CONFIGDATA_PATH("SYSCONFDIR"),
+	CONFIGDATA_PATH("PGXS"),
+	CONFIGDATA_BUILTIN("CONFIGURE", "configure", VAL_CONFIGURE),
+	CONFIGDATA_BUILTIN("CC", "compiler", VAL_CC),
+	CONFIGDATA_BUILTIN("CPPFLAGS", "compiler", VAL_CPPFLAGS),
+	CONFIGDATA_BUILTIN("CFLAGS", "compiler", VAL_CFLAGS),
+	CONFIGDATA_BUILTIN("CFLAGS_SL", "compiler", VAL_CFLAGS_SL),
+	CONFIGDATA_BUILTIN("LDFLAGS", "linker", VAL_LDFLAGS),
+	CONFIGDATA_BUILTIN("LDFLAGS_SL", "linker", VAL_LDFLAGS_SL),
+	CONFIGDATA_BUILTIN("LIBS", "linker", VAL_LIBS),
+	CONFIGDATA_BUILTIN("VERSION", "version", "PostgreSQL " PG_VERSION),
+	{NULL, NULL, NULL, 0, NULL, NULL}
+};
+
+/*
+ * The settings above are computed once per backend and kept in their own
+ * long-lived memory context, so that repeated scans of the view only have
+ * to emit tuples.  pg_config_cache_reset() throws the cached values away.
+ * ConfigDataGeneration is the shared generation the cache was loaded at.
+ */
+static MemoryContext ConfigDataContext = NULL;
+static bool ConfigDataValid = false;
+static uint32 ConfigDataGeneration = 0;
+
+/*
+ * pg_config_fingerprint() results, overall and for each category, cached
+ * along with the settings and discarded with them.
+ */
+static const char *const FingerprintCategories[] =
+{
+	"paths", "configure", "compiler", "linker", "version"
 };
 
-static const char *dbState(DBState state);
+static char ConfigDataFingerprint[lengthof(FingerprintCategories) + 1][33];
+static bool ConfigDataFingerprintValid = false;
+
+/*
+ * pg_config_json() result, serialized into a single allocation in
+ * ConfigDataContext and discarded with the settings.  NULL until built.
+ */
+static text *ConfigDataJson = NULL;
+
+/*
+ * ConfigData[] indexes ordered by name in byte order, for binary search by
+ * lookup_configdata() and as the canonical row order of
+ * pg_config_fingerprint().  Built on first use by sort_configdata().
+ */
+static int	ConfigDataSorted[lengthof(ConfigData) - 1];
+static bool ConfigDataSortedValid = false;
+
+/*
+ * When the module is loaded via shared_preload_libraries, the postmaster
+ * resolves the installation paths once and stores them in a small shared
+ * memory segment, packed as consecutive NUL-terminated strings in
+ * ConfigData order.  Backends then fill their cache with a single copy
+ * out of that segment instead of resolving the paths themselves.
+ *
+ * pg_config_reset() rebuilds the table and advances generation; each
+ * backend compares that against the generation its cache was loaded at,
+ * which is a single unlocked read on the fast path.
+ */
+typedef struct pgcSharedState
+{
+	LWLockId	lock;			/* protects the fields below */
+	uint32		generation;		/* bumped by every pg_config_reset() */
+	Size		datalen;		/* bytes of data[] in use, 0 if not filled */
+	char		data[1];		/* VARIABLE LENGTH ARRAY */
+} pgcSharedState;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static pgcSharedState *pgc_shared = NULL;
+static Size pgc_shared_datalen = 0;
+
 static void get_configdata(void);
 
 Datum pg_config(PG_FUNCTION_ARGS);
+Datum pg_config_value(PG_FUNCTION_ARGS);
+Datum pg_config_reset(PG_FUNCTION_ARGS);
+Datum pg_config_fingerprint(PG_FUNCTION_ARGS);
+Datum pg_config_json(PG_FUNCTION_ARGS);
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	DefineCustomBoolVariable("pg_config.watch_install",
+							 "Uses inotify to notice changes to the installation directories.",
+							 "When off, cached file listings are revalidated with stat() on every call.",
+							 &pgc_watch_install,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("pg_config.history_size",
+							"Sets the number of samples kept in pg_config_history.",
+							NULL,
+							&pgc_history_size,
+							256,
+							16,
+							65536,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("pg_config.history_interval",
+							"Sets the minimum time between pg_config_history samples.",
+							NULL,
+							&pgc_history_interval,
+							60,
+							0,
+							INT_MAX / 1000,
+							PGC_SIGHUP,
+							GUC_UNIT_S,
+							NULL,
+							NULL);
+
+	/*
+	 * The shared snapshot can only be set up if we are being preloaded;
+	 * otherwise get_configdata() computes the settings lazily in each
+	 * backend.
+	 */
+	if (!process_shared_preload_libraries_in_progress)
+	{
+		/* time the rest of local_preload_libraries, if we head it */
+		pgc_loadprof_local_init();
+		return;
+	}
+
+	/* measure the packed settings so we can request exactly enough space */
+	pgc_shared_datalen = pack_configdata(NULL, 0);
+
+	RequestAddinShmemSpace(add_size(pgc_memsize(), pgc_history_memsize()));
+	RequestAddinLWLocks(1);
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = pgc_shmem_startup;
+
+	/* time the libraries preloaded after us, and any LOAD */
+	pgc_loadprof_init();
+}
+
+/*
+ * Module unload callback
+ */
+void
+_PG_fini(void)
+{
+	/* Uninstall hooks. */
+	shmem_startup_hook = prev_shmem_startup_hook;
+	pgc_loadprof_fini();
+}
+
+/*
+ * Estimate shared memory space needed.
+ */
+static Size
+pgc_memsize(void)
+{
+	return add_size(offsetof(pgcSharedState, data), pgc_shared_datalen);
+}
+
+/*
+ * shmem_startup hook: allocate and fill the shared settings table
+ */
+static void
+pgc_shmem_startup(void)
+{
+	bool		found;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	pgc_shared = NULL;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	pgc_shared = ShmemInitStruct("pg_config", pgc_memsize(), &found);
+	if (!found)
+	{
+		pgc_shared->lock = LWLockAssign();
+		pgc_shared->generation = 0;
+		pgc_shared->datalen = pack_configdata(pgc_shared->data,
+											  pgc_shared_datalen);
+	}
+
+	pgc_history_shmem_init();
+
+	LWLockRelease(AddinShmemInitLock);
+}
 
 PG_FUNCTION_INFO_V1(pg_config);
 Datum
@@ -97,20 +344,20 @@ pg_config(PG_FUNCTION_ARGS)
 {
 	ReturnSetInfo	   *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
 	Tuplestorestate	   *tupstore;
-	HeapTuple			tuple;
 	TupleDesc			tupdesc;
-	AttInMetadata	   *attinmeta;
 	MemoryContext		per_query_ctx;
 	MemoryContext		oldcontext;
-	char			   *values[2];
 	int					i = 0;
 
-	/* check to see if caller supports us returning a tuplestore */
-	if (!rsinfo || !(rsinfo->allowedModes & SFRM_Materialize))
-		ereport(ERROR,
-				(errcode(ERRCODE_SYNTAX_ERROR),
-				 errmsg("materialize mode required, but it is not "
-						"allowed in this context")));
+	/*
+	 * Return one row per call unless the caller can only take a tuplestore,
+	 * or says it would rather have one.
+	 */
+	if (!rsinfo || !IsA(rsinfo, ReturnSetInfo) ||
+		!(rsinfo->allowedModes & SFRM_Materialize) ||
+		((rsinfo->allowedModes & SFRM_ValuePerCall) &&
+		 !(rsinfo->allowedModes & SFRM_Materialize_Preferred)))
+		return pg_config_percall(fcinfo);
 
 	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
 	oldcontext = MemoryContextSwitchTo(per_query_ctx);
@@ -129,9 +376,6 @@ pg_config(PG_FUNCTION_ARGS)
 				 errmsg("query-specified return tuple and "
 						"function return type are not compatible")));
 
-	/* OK to use it */
-	attinmeta = TupleDescGetAttInMetadata(tupdesc);
-
 	/* let the caller know we're sending back a tuplestore */
 	rsinfo->returnMode = SFRM_Materialize;
 
@@ -141,19 +385,9 @@ pg_config(PG_FUNCTION_ARGS)
 	get_configdata();
 	while (ConfigData[i].name)
 	{
-		values[0] = ConfigData[i].name;
-		values[1] = ConfigData[i].setting;
-
-		tuple = BuildTupleFromCStrings(attinmeta, values);
-		tuplestore_puttuple(tupstore, tuple);
+		tuplestore_puttuple(tupstore, get_configtuple(i, tupdesc));
 		++i;
 	}
-	
-	/*
-	 * no longer need the tuple descriptor reference created by
-	 * TupleDescGetAttInMetadata()
-	 */
-	ReleaseTupleDesc(tupdesc);
 
 	tuplestore_donestoring(tupstore);
 	rsinfo->setResult = tupstore;
@@ -171,6 +405,270 @@ pg_config(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * ValuePerCall implementation of pg_config(): walk ConfigData[] and return
+ * one row per call, without building a tuplestore.  Rows are formed afresh
+ * in the per-call memory context rather than handed out from the cache, as
+ * the caller may hold on to them across a pg_config_reset().
+ */
+static Datum
+pg_config_percall(FunctionCallInfo fcinfo)
+{
+	FuncCallContext	   *funcctx;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext	oldcontext;
+		TupleDesc		tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		/* Build a tuple descriptor for our result type */
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			elog(ERROR, "return type must be a row type");
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		funcctx->max_calls = lengthof(ConfigData) - 1;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		int			i = funcctx->call_cntr;
+		Datum		values[2];
+		bool		nulls[2] = {false, false};
+		HeapTuple	tuple;
+
+		get_configdata();
+		values[0] = CStringGetTextDatum(ConfigData[i].name);
+		values[1] = PointerGetDatum(setting_text(i));
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+/*
+ * pg_config(name text) returns text
+ *
+ * Return a single setting.  Only the requested setting is computed if the
+ * cache is not yet filled, and no tuplestore is built.
+ */
+PG_FUNCTION_INFO_V1(pg_config_value);
+Datum
+pg_config_value(PG_FUNCTION_ARGS)
+{
+	char	   *name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	const char *setting;
+
+	setting = pg_config_get_setting(name);
+	if (setting == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("unrecognized pg_config setting \"%s\"", name)));
+
+	PG_RETURN_TEXT_P(cstring_to_text(setting));
+}
+
+/*
+ * Return the cached setting called name, computing only that setting if
+ * the cache is not filled yet.  Returns NULL for an unknown name.
+ */
+const char *
+pg_config_get_setting(const char *name)
+{
+	int			i;
+
+	i = lookup_configdata(name);
+	if (i < 0)
+		return NULL;
+
+	if (pgc_shared && pgc_shared->datalen > 0)
+		get_configdata();
+	else if (ConfigData[i].setting == NULL)
+	{
+		MemoryContext	oldcontext;
+
+		oldcontext = MemoryContextSwitchTo(get_configdata_context());
+		ConfigData[i].setting = compute_setting(i);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	return ConfigData[i].setting;
+}
+
+/*
+ * The pg_config_fingerprint() of all rows, as a hex string.
+ */
+const char *
+pg_config_get_fingerprint(void)
+{
+	get_configdata();
+	if (!ConfigDataFingerprintValid)
+		compute_fingerprints();
+
+	return ConfigDataFingerprint[0];
+}
+
+/*
+ * pg_config_fingerprint() returns text
+ * pg_config_fingerprint(category text) returns text
+ *
+ * An MD5 hash, in hex, of the settings in canonical form: one line
+ * "NAME=setting\n" per row, sorted by name in byte order, with runs of
+ * white space in the setting collapsed to one space and trimmed at both
+ * ends.  With a category, only that category's rows are included.
+ * Computed once per backend and cached with the settings.
+ */
+PG_FUNCTION_INFO_V1(pg_config_fingerprint);
+Datum
+pg_config_fingerprint(PG_FUNCTION_ARGS)
+{
+	char	   *category;
+	int			c;
+
+	if (PG_NARGS() == 0)
+		PG_RETURN_TEXT_P(cstring_to_text(pg_config_get_fingerprint()));
+
+	get_configdata();
+	if (!ConfigDataFingerprintValid)
+		compute_fingerprints();
+
+	category = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	for (c = 0; c < lengthof(FingerprintCategories); c++)
+	{
+		if (pg_strcasecmp(category, FingerprintCategories[c]) == 0)
+			break;
+	}
+	if (c == lengthof(FingerprintCategories))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("unrecognized pg_config category \"%s\"", category),
+				 errhint("Valid categories are paths, configure, compiler, linker and version.")));
+
+	PG_RETURN_TEXT_P(cstring_to_text(ConfigDataFingerprint[c + 1]));
+}
+
+/*
+ * pg_config_json() returns text
+ *
+ * All settings as one JSON object keyed by name, the same shape as
+ * json_object_agg(name, setting) over the view, plus "configure_options"
+ * and "flags" arrays holding the rows of pg_config_configure_options()
+ * and pg_config_flags().  The document is measured, serialized into a
+ * single allocation and cached with the settings, so later calls only
+ * copy it.
+ */
+PG_FUNCTION_INFO_V1(pg_config_json);
+Datum
+pg_config_json(PG_FUNCTION_ARGS)
+{
+	text	   *result;
+
+	get_configdata();
+	if (ConfigDataJson == NULL)
+	{
+		Size		len = 0;
+		Size		written = 0;
+		text	   *json;
+
+		serialize_json(NULL, &len);
+		json = MemoryContextAlloc(get_configdata_context(), VARHDRSZ + len);
+		serialize_json(VARDATA(json), &written);
+		Assert(written == len);
+		SET_VARSIZE(json, VARHDRSZ + len);
+		ConfigDataJson = json;
+	}
+
+	result = palloc(VARSIZE(ConfigDataJson));
+	memcpy(result, ConfigDataJson, VARSIZE(ConfigDataJson));
+
+	PG_RETURN_TEXT_P(result);
+}
+
+/*
+ * pg_config_reset() returns void
+ *
+ * Throw away this backend's cached settings.  If the shared snapshot is in
+ * use, rebuild it too, so that every backend reloads on its next call.
+ */
+PG_FUNCTION_INFO_V1(pg_config_reset);
+Datum
+pg_config_reset(PG_FUNCTION_ARGS)
+{
+	pg_config_cache_reset();
+
+	if (pgc_shared)
+	{
+		char	   *data;
+		Size		datalen;
+
+		data = palloc(pgc_shared_datalen);
+		datalen = pack_configdata(data, pgc_shared_datalen);
+		if (datalen == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("pg_config settings no longer fit in shared memory"),
+					 errhint("Restart the server to resize the shared snapshot.")));
+
+		LWLockAcquire(pgc_shared->lock, LW_EXCLUSIVE);
+		memcpy(pgc_shared->data, data, datalen);
+		pgc_shared->datalen = datalen;
+		pgc_shared->generation++;
+		LWLockRelease(pgc_shared->lock);
+
+		pfree(data);
+	}
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Prepare to return the result of a set-returning function in materialize
+ * mode, using the row type declared by its OUT parameters.  Returns the
+ * tuplestore to fill, and the tuple descriptor in *tupdesc.
+ */
+Tuplestorestate *
+pgc_init_materialize(FunctionCallInfo fcinfo, TupleDesc *tupdesc)
+{
+	ReturnSetInfo	   *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate	   *tupstore;
+	MemoryContext		per_query_ctx;
+	MemoryContext		oldcontext;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not "
+						"allowed in this context")));
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = *tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return tupstore;
+}
+
 
 /*
  * This function cleans up the paths for use with either cmd.exe or Msys
@@ -201,117 +699,508 @@ cleanup_path(char *path)
 #endif
 }
 
+/*
+ * Invalidate the cached ConfigData settings; the next call of
+ * get_configdata() recomputes them.
+ */
+void
+pg_config_cache_reset(void)
+{
+	int			i;
+
+	for (i = 0; ConfigData[i].name; i++)
+	{
+		ConfigData[i].setting = NULL;
+		ConfigData[i].tuple = NULL;
+	}
+
+	if (ConfigDataContext)
+		MemoryContextReset(ConfigDataContext);
+	ConfigDataValid = false;
+	ConfigDataFingerprintValid = false;
+	ConfigDataJson = NULL;
+}
+
+/*
+ * Make sure ConfigData[] holds valid settings, either from the shared
+ * snapshot or by computing them in this backend.
+ */
 static void
 get_configdata(void)
 {
-	char			path[MAXPGPATH];
-	char		   *lastsep;
+	MemoryContext	oldcontext;
 
-	strcpy(path, my_exec_path);
-	lastsep = strrchr(path, '/');
-	if (lastsep)
-		*lastsep = '\0';
-	cleanup_path(path);
-	ConfigData[0].setting = pstrdup(path);
+	if (ConfigDataValid)
+	{
+		volatile pgcSharedState *shared = pgc_shared;
 
-	get_doc_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[1].setting = pstrdup(path);
+		if (shared == NULL || shared->generation == ConfigDataGeneration)
+			return;
 
-	get_html_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[2].setting = pstrdup(path);
+		/* someone called pg_config_reset(); start over */
+		pg_config_cache_reset();
+	}
 
-	get_include_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[3].setting = pstrdup(path);
+	oldcontext = MemoryContextSwitchTo(get_configdata_context());
 
-	get_pkginclude_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[4].setting = pstrdup(path);
+	if (pgc_shared && pgc_shared->datalen > 0)
+		load_shared_configdata();
+	else
+		compute_configdata();
 
-	get_includeserver_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[5].setting = pstrdup(path);
+	MemoryContextSwitchTo(oldcontext);
+	ConfigDataValid = true;
+}
 
-	get_lib_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[6].setting = pstrdup(path);
+/*
+ * Fill ConfigDataFingerprint[] from the current settings.
+ */
+static void
+compute_fingerprints(void)
+{
+	int			i;
 
-	get_pkglib_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[7].setting = pstrdup(path);
+	sort_configdata();
 
-	get_locale_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[8].setting = pstrdup(path);
+	fingerprint_category(NULL, ConfigDataFingerprint[0]);
+	for (i = 0; i < lengthof(FingerprintCategories); i++)
+		fingerprint_category(FingerprintCategories[i],
+							 ConfigDataFingerprint[i + 1]);
 
-	get_man_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[9].setting = pstrdup(path);
+	ConfigDataFingerprintValid = true;
+}
 
-	get_share_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[10].setting = pstrdup(path);
+/*
+ * Hash the canonical form of the rows in category (all rows if NULL),
+ * taken in ConfigDataSorted[] order, into hexsum.
+ */
+static void
+fingerprint_category(const char *category, char *hexsum)
+{
+	StringInfoData buf;
+	int			i;
 
-	get_etc_path(my_exec_path, path);
-	cleanup_path(path);
-	ConfigData[11].setting = pstrdup(path);
+	initStringInfo(&buf);
 
-	get_pkglib_path(my_exec_path, path);
-	conf_strlcat(path, "/pgxs/src/makefiles/pgxs.mk", sizeof(path));
-	cleanup_path(path);
-	ConfigData[12].setting = pstrdup(path);
+	for (i = 0; i < lengthof(ConfigData) - 1; i++)
+	{
+		struct configdata *row = &ConfigData[ConfigDataSorted[i]];
+		const char *p = row->setting ? row->setting : "";
+		bool		space = false;
 
-#ifdef VAL_CONFIGURE
-	ConfigData[13].setting = pstrdup(VAL_CONFIGURE);
-#else
-	ConfigData[13].setting = pstrdup("not recorded");
-#endif
+		if (category && strcmp(row->category, category) != 0)
+			continue;
 
-#ifdef VAL_CC
-	ConfigData[14].setting = pstrdup(VAL_CC);
-#else
-	ConfigData[14].setting = pstrdup("not recorded");
-#endif
+		appendStringInfo(&buf, "%s=", row->name);
+		while (isspace((unsigned char) *p))
+			p++;
+		for (; *p; p++)
+		{
+			if (isspace((unsigned char) *p))
+				space = true;
+			else
+			{
+				if (space)
+					appendStringInfoChar(&buf, ' ');
+				appendStringInfoChar(&buf, *p);
+				space = false;
+			}
+		}
+		appendStringInfoChar(&buf, '\n');
+	}
 
-#ifdef VAL_CPPFLAGS
-	ConfigData[15].setting = pstrdup(VAL_CPPFLAGS);
-#else
-	ConfigData[15].setting = pstrdup("not recorded");
-#endif
+	if (!pg_md5_hash(buf.data, buf.len, hexsum))
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
 
-#ifdef VAL_CFLAGS
-	ConfigData[16].setting = pstrdup(VAL_CFLAGS);
-#else
-	ConfigData[16].setting = pstrdup("not recorded");
-#endif
+	pfree(buf.data);
+}
 
-#ifdef VAL_CFLAGS_SL
-	ConfigData[17].setting = pstrdup(VAL_CFLAGS_SL);
-#else
-	ConfigData[17].setting = pstrdup("not recorded");
-#endif
+/*
+ * Write the pg_config_json() document for the current settings at dst,
+ * advancing *len past it.  If dst is NULL, only measure.
+ */
+static void
+serialize_json(char *dst, Size *len)
+{
+	int			i;
 
-#ifdef VAL_LDFLAGS
-	ConfigData[18].setting = pstrdup(VAL_LDFLAGS);
-#else
-	ConfigData[18].setting = pstrdup("not recorded");
-#endif
+	pgc_json_append(dst, len, "{");
+	for (i = 0; ConfigData[i].name; i++)
+	{
+		pgc_json_quote(dst, len, ConfigData[i].name);
+		pgc_json_append(dst, len, ":");
+		pgc_json_quote(dst, len, ConfigData[i].setting);
+		pgc_json_append(dst, len, ",");
+	}
+	pgc_json_parsed(dst, len);
+	pgc_json_append(dst, len, "}");
+}
 
-#ifdef VAL_LDFLAGS_SL
-	ConfigData[19].setting = pstrdup(VAL_LDFLAGS_SL);
-#else
-	ConfigData[19].setting = pstrdup("not recorded");
-#endif
+/*
+ * Append str verbatim at dst + *len and advance *len.  If dst is NULL,
+ * only advance *len.
+ */
+void
+pgc_json_append(char *dst, Size *len, const char *str)
+{
+	Size		slen = strlen(str);
 
-#ifdef VAL_LIBS
-	ConfigData[20].setting = pstrdup(VAL_LIBS);
-#else
-	ConfigData[20].setting = pstrdup("not recorded");
-#endif
+	if (dst)
+		memcpy(dst + *len, str, slen);
+	*len += slen;
+}
+
+/*
+ * Like pgc_json_append(), but write str as a JSON string literal, or null
+ * if str is NULL.  Bytes outside ASCII are copied as they are, so the
+ * result is in the server encoding.
+ */
+void
+pgc_json_quote(char *dst, Size *len, const char *str)
+{
+	const char *p;
+
+	if (str == NULL)
+	{
+		pgc_json_append(dst, len, "null");
+		return;
+	}
+
+	pgc_json_append(dst, len, "\"");
+	for (p = str; *p; p++)
+	{
+		unsigned char c = (unsigned char) *p;
+		char		esc[7];
+
+		switch (c)
+		{
+			case '"':
+				pgc_json_append(dst, len, "\\\"");
+				break;
+			case '\\':
+				pgc_json_append(dst, len, "\\\\");
+				break;
+			case '\n':
+				pgc_json_append(dst, len, "\\n");
+				break;
+			case '\r':
+				pgc_json_append(dst, len, "\\r");
+				break;
+			case '\t':
+				pgc_json_append(dst, len, "\\t");
+				break;
+			default:
+				if (c < 0x20)
+				{
+					snprintf(esc, sizeof(esc), "\\u%04x", c);
+					pgc_json_append(dst, len, esc);
+				}
+				else
+				{
+					if (dst)
+						dst[*len] = c;
+					(*len)++;
+				}
+				break;
+		}
+	}
+	pgc_json_append(dst, len, "\"");
+}
+
+/*
+ * Return the memory context holding the cached settings, creating it if
+ * needed.
+ */
+static MemoryContext
+get_configdata_context(void)
+{
+	if (ConfigDataContext == NULL)
+		ConfigDataContext = AllocSetContextCreate(TopMemoryContext,
+												  "pg_config cache",
+												  ALLOCSET_SMALL_MINSIZE,
+												  ALLOCSET_SMALL_INITSIZE,
+												  ALLOCSET_SMALL_MAXSIZE);
+	return ConfigDataContext;
+}
+
+/*
+ * Find the ConfigData[] index of the setting called name, ignoring case.
+ * Returns -1 if there is no such setting.
+ *
+ * The names are all upper case, so folding the key to upper case lets us
+ * search the byte-ordered index that pg_config_fingerprint() uses too.
+ */
+static int
+lookup_configdata(const char *name)
+{
+	char		key[NAMEDATALEN];
+	int			lo;
+	int			hi;
+	int			i;
+
+	for (i = 0; name[i]; i++)
+	{
+		if (i >= sizeof(key) - 1)
+			return -1;
+		key[i] = pg_toupper((unsigned char) name[i]);
+	}
+	key[i] = '\0';
+
+	sort_configdata();
+
+	lo = 0;
+	hi = lengthof(ConfigDataSorted) - 1;
+	while (lo <= hi)
+	{
+		int			mid = (lo + hi) / 2;
+		int			cmp;
+
+		cmp = strcmp(key, ConfigData[ConfigDataSorted[mid]].name);
+		if (cmp == 0)
+			return ConfigDataSorted[mid];
+		else if (cmp < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+
+	return -1;
+}
+
+/*
+ * Build ConfigDataSorted[], if not done yet.
+ */
+static void
+sort_configdata(void)
+{
+	int			i;
+
+	if (ConfigDataSortedValid)
+		return;
+
+	for (i = 0; ConfigData[i].name; i++)
+		ConfigDataSorted[i] = i;
+	qsort(ConfigDataSorted, lengthof(ConfigDataSorted), sizeof(int),
+		  configdata_name_cmp);
+	ConfigDataSortedValid = true;
+}
+
+static int
+configdata_name_cmp(const void *a, const void *b)
+{
+	return strcmp(ConfigData[*(const int *) a].name,
+				  ConfigData[*(const int *) b].name);
+}
+
+/*
+ * Return the (name, setting) row for ConfigData[i], building it on first
+ * use.  The tuple is kept in the cache context, so later scans only pay
+ * for the copy into the tuplestore rather than running the text input
+ * function on every column again.  The caller must already have checked
+ * that tupdesc is (text, text), and called get_configdata().
+ */
+static HeapTuple
+get_configtuple(int i, TupleDesc tupdesc)
+{
+	if (ConfigData[i].tuple == NULL)
+	{
+		MemoryContext	oldcontext;
+		Datum			values[2];
+		bool			nulls[2] = {false, false};
+
+		oldcontext = MemoryContextSwitchTo(ConfigDataContext);
+		values[0] = CStringGetTextDatum(ConfigData[i].name);
+		values[1] = PointerGetDatum(setting_text(i));
+		ConfigData[i].tuple = heap_form_tuple(tupdesc, values, nulls);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	return ConfigData[i].tuple;
+}
+
+/*
+ * Return ConfigData[i].setting as text.  Build-time settings carry their
+ * length with them, so only the installation paths need a strlen().
+ */
+static text *
+setting_text(int i)
+{
+	if (ConfigData[i].value)
+		return cstring_to_text_with_len(ConfigData[i].value,
+										ConfigData[i].valuelen);
+	return cstring_to_text(ConfigData[i].setting);
+}
+
+/*
+ * Copy the packed installation paths out of shared memory into the current
+ * memory context, and point ConfigData[] at them.  Build-time settings are
+ * not stored in shared memory; they point at the constants directly.
+ */
+static void
+load_shared_configdata(void)
+{
+	char	   *data;
+	char	   *ptr;
+	int			i;
 
-	ConfigData[21].setting = pstrdup("PostgreSQL " PG_VERSION);
+	LWLockAcquire(pgc_shared->lock, LW_SHARED);
+	data = palloc(pgc_shared->datalen);
+	memcpy(data, pgc_shared->data, pgc_shared->datalen);
+	ConfigDataGeneration = pgc_shared->generation;
+	LWLockRelease(pgc_shared->lock);
+
+	ptr = data;
+	for (i = 0; ConfigData[i].name; i++)
+	{
+		if (ConfigData[i].value)
+			ConfigData[i].setting = ConfigData[i].value;
+		else
+		{
+			ConfigData[i].setting = ptr;
+			ptr += strlen(ptr) + 1;
+		}
+	}
+}
+
+/*
+ * Compute the installation paths in a scratch memory context and pack them
+ * into dst as consecutive NUL-terminated strings.  If dst is NULL, only
+ * measure.
+ * Returns the packed length, or 0 if the result would not fit in dstsize.
+ */
+static Size
+pack_configdata(char *dst, Size dstsize)
+{
+	MemoryContext	tmpcontext;
+	MemoryContext	oldcontext;
+	Size			len = 0;
+	int				i;
+
+	Assert(!ConfigDataValid);
+
+	tmpcontext = AllocSetContextCreate(CurrentMemoryContext,
+									   "pg_config pack",
+									   ALLOCSET_SMALL_MINSIZE,
+									   ALLOCSET_SMALL_INITSIZE,
+									   ALLOCSET_SMALL_MAXSIZE);
+	oldcontext = MemoryContextSwitchTo(tmpcontext);
+
+	compute_configdata();
+
+	for (i = 0; ConfigData[i].name; i++)
+	{
+		Size		slen;
+
+		if (ConfigData[i].value)
+			continue;
+
+		slen = strlen(ConfigData[i].setting) + 1;
+
+		if (dst)
+		{
+			if (len + slen > dstsize)
+			{
+				len = 0;
+				break;
+			}
+			memcpy(dst + len, ConfigData[i].setting, slen);
+		}
+		len += slen;
+	}
+
+	for (i = 0; ConfigData[i].name; i++)
+		ConfigData[i].setting = NULL;
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextDelete(tmpcontext);
+
+	return len;
+}
+
+/*
+ * Resolve every setting not yet known into the current memory context.
+ */
+static void
+compute_configdata(void)
+{
+	int			i;
+
+	for (i = 0; ConfigData[i].name; i++)
+	{
+		if (ConfigData[i].setting == NULL)
+			ConfigData[i].setting = compute_setting(i);
+	}
+}
+
+/*
+ * Resolve the setting for ConfigData[i].  Settings fixed at build time are
+ * returned as is; the installation paths, which depend on where the
+ * server executable lives, are resolved into a palloc'd string.
+ */
+static const char *
+compute_setting(int i)
+{
+	char			path[MAXPGPATH];
+	char		   *lastsep;
+
+	if (ConfigData[i].value)
+		return ConfigData[i].value;
+
+	switch (i)
+	{
+		case 0:
+			strcpy(path, my_exec_path);
+			lastsep = strrchr(path, '/');
+			if (lastsep)
+				*lastsep = '\0';
+			break;
+		case 1:
+			get_doc_path(my_exec_path, path);
+			break;
+		case 2:
+			get_html_path(my_exec_path, path);
+			break;
+		case 3:
+			get_include_path(my_exec_path, path);
+			break;
+		case 4:
+			get_pkginclude_path(my_exec_path, path);
+			break;
+		case 5:
+			get_includeserver_path(my_exec_path, path);
+			break;
+		case 6:
+			get_lib_path(my_exec_path, path);
+			break;
+		case 7:
+			get_pkglib_path(my_exec_path, path);
+			break;
+		case 8:
+			get_locale_path(my_exec_path, path);
+			break;
+		case 9:
+			get_man_path(my_exec_path, path);
+			break;
+		case 10:
+			get_share_path(my_exec_path, path);
+			break;
+		case 11:
+			get_etc_path(my_exec_path, path);
+			break;
+		case 12:
+			get_pkglib_path(my_exec_path, path);
+			conf_strlcat(path, "/pgxs/src/makefiles/pgxs.mk", sizeof(path));
+			break;
+
+		default:
+			elog(ERROR, "invalid pg_config setting number %d", i);
+			return NULL;		/* keep compiler quiet */
+	}
+
+	cleanup_path(path);
+	return pstrdup(path);
 }
 
 static size_t
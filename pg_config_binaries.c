@@ -0,0 +1,453 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_binaries.c
+ *		Fingerprint the installed server binaries and loadable modules.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+#include "pg_config_int.h"
+
+/*
+ * Hashing the whole installation is expensive, so each file's hash is
+ * remembered along with the stat() fields that would change if the file
+ * were replaced or rewritten, and recomputed only when they do.  Entries
+ * for files that have disappeared are dropped at the end of each scan.
+ * When the directories are being watched and nothing has changed since
+ * the last complete scan, there is no need to walk them at all.
+ */
+typedef struct BinaryHashEntry
+{
+	char		path[MAXPGPATH];	/* hash key */
+	const char *dirname;		/* setting the file was found under */
+	dev_t		dev;
+	ino_t		ino;
+	off_t		size;
+	time_t		mtime;
+	uint64		hash;
+	bool		hash_valid;		/* false if the file could not be read */
+	uint32		scan;			/* last scan that saw this file */
+} BinaryHashEntry;
+
+/*
+ * Running state of an XXH64 computation, for hashing a file a chunk at a
+ * time.
+ */
+typedef struct XXH64State
+{
+	uint64		v1;
+	uint64		v2;
+	uint64		v3;
+	uint64		v4;
+	uint64		seed;
+	uint64		total;			/* bytes fed so far */
+	unsigned char buf[32];		/* partial stripe not yet consumed */
+	size_t		buflen;
+} XXH64State;
+
+/* files are hashed through one reused buffer of this size */
+#define HASH_CHUNK_SIZE		65536
+
+static HTAB *BinaryHashes = NULL;
+static char *HashBuffer = NULL;
+static uint32 BinaryScan = 0;
+static bool BinaryHashesValid = false;
+static uint32 BinaryHashesGeneration = 0;
+
+static void scan_directory(const char *dirname, const char *dirpath);
+static bool hash_file(const char *path, const struct stat *st, uint64 *hash);
+static void xxh64_init(XXH64State *state, uint64 seed);
+static void xxh64_update(XXH64State *state, const void *data, size_t len);
+static uint64 xxh64_final(const XXH64State *state);
+
+Datum pg_config_binaries(PG_FUNCTION_ARGS);
+
+/*
+ * pg_config_binaries() returns setof (directory text, path text,
+ *									   size bigint, mtime timestamptz,
+ *									   hash text)
+ *
+ * One row per regular file under BINDIR and PKGLIBDIR, with a 64-bit
+ * XXH64 hash of its contents in hex.  The hash is NULL for files we are
+ * not allowed to read, or that otherwise could not be read.
+ */
+PG_FUNCTION_INFO_V1(pg_config_binaries);
+Datum
+pg_config_binaries(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	HASH_SEQ_STATUS		status;
+	BinaryHashEntry	   *entry;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	if (BinaryHashes == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = MAXPGPATH;
+		ctl.entrysize = sizeof(BinaryHashEntry);
+		BinaryHashes = hash_create("pg_config binary hashes", 256, &ctl,
+								   HASH_ELEM);
+	}
+
+	if (!pgc_install_unchanged(&BinaryHashesGeneration) || !BinaryHashesValid)
+	{
+		BinaryHashesValid = false;
+		BinaryScan++;
+		scan_directory("BINDIR", pg_config_get_setting("BINDIR"));
+		scan_directory("PKGLIBDIR", pg_config_get_setting("PKGLIBDIR"));
+
+		/* forget files that are gone */
+		hash_seq_init(&status, BinaryHashes);
+		while ((entry = (BinaryHashEntry *) hash_seq_search(&status)) != NULL)
+		{
+			if (entry->scan != BinaryScan)
+				hash_search(BinaryHashes, entry->path, HASH_REMOVE, NULL);
+		}
+		BinaryHashesValid = true;
+	}
+
+	hash_seq_init(&status, BinaryHashes);
+	while ((entry = (BinaryHashEntry *) hash_seq_search(&status)) != NULL)
+	{
+		Datum		values[5];
+		bool		nulls[5] = {false, false, false, false, false};
+		char		hashbuf[17];
+
+		values[0] = CStringGetTextDatum(entry->dirname);
+		values[1] = CStringGetTextDatum(entry->path);
+		values[2] = Int64GetDatum((int64) entry->size);
+		values[3] = TimestampTzGetDatum(time_t_to_timestamptz(entry->mtime));
+		if (entry->hash_valid)
+		{
+			snprintf(hashbuf, sizeof(hashbuf), "%08x%08x",
+					 (uint32) (entry->hash >> 32), (uint32) entry->hash);
+			values[4] = CStringGetTextDatum(hashbuf);
+		}
+		else
+			nulls[4] = true;
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Bring the entries for every regular file under dirpath up to date,
+ * recursing into subdirectories.  Symbolic links are not followed.
+ */
+static void
+scan_directory(const char *dirname, const char *dirpath)
+{
+	DIR		   *dir;
+	struct dirent *de;
+
+	pgc_install_watch(dirpath);
+	dir = AllocateDir(dirpath);
+	if (dir == NULL)
+	{
+		/* a missing directory just has nothing to report */
+		if (errno == ENOENT)
+			return;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open directory \"%s\": %m", dirpath)));
+	}
+
+	while ((de = ReadDir(dir, dirpath)) != NULL)
+	{
+		char		path[MAXPGPATH];
+		struct stat st;
+		BinaryHashEntry *entry;
+		bool		found;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", dirpath, de->d_name);
+		if (lstat(path, &st) < 0)
+			continue;			/* removed while we were looking */
+
+		if (S_ISDIR(st.st_mode))
+		{
+			scan_directory(dirname, path);
+			continue;
+		}
+		if (!S_ISREG(st.st_mode))
+			continue;
+
+		entry = (BinaryHashEntry *) hash_search(BinaryHashes, path,
+												HASH_ENTER, &found);
+		if (!found)
+		{
+			entry->dirname = dirname;
+			entry->scan = 0;
+		}
+		if (!found || !entry->hash_valid ||
+			entry->dev != st.st_dev ||
+			entry->ino != st.st_ino ||
+			entry->size != st.st_size ||
+			entry->mtime != st.st_mtime)
+		{
+			/* if hashing fails, make sure the next scan retries */
+			entry->mtime = 0;
+			entry->hash_valid = hash_file(path, &st, &entry->hash);
+			entry->dev = st.st_dev;
+			entry->ino = st.st_ino;
+			entry->size = st.st_size;
+			entry->mtime = st.st_mtime;
+		}
+		entry->dirname = dirname;
+		entry->scan = BinaryScan;
+	}
+
+	FreeDir(dir);
+}
+
+/*
+ * Hash the contents of the file at path, which stat() described as st,
+ * into *hash.  Returns false if the file could not be read; one unreadable
+ * file, such as a root-only leftover of an install, must not keep the
+ * rest from being listed.  Such files are retried on the next scan.
+ *
+ * The file is read rather than mapped: it may be truncated under us by an
+ * install in progress, which would kill the backend with SIGBUS on a
+ * mapping.  A file that turns out shorter or longer than st said is being
+ * changed, and is likewise reported as unreadable for now.
+ */
+static bool
+hash_file(const char *path, const struct stat *st, uint64 *hash)
+{
+	XXH64State	state;
+	off_t		total = 0;
+	bool		failed = false;
+	int			fd;
+
+	if (HashBuffer == NULL)
+		HashBuffer = MemoryContextAlloc(TopMemoryContext, HASH_CHUNK_SIZE);
+
+	fd = BasicOpenFile((char *) path, O_RDONLY | PG_BINARY, 0);
+	if (fd < 0)
+		return false;
+
+	xxh64_init(&state, 0);
+	for (;;)
+	{
+		ssize_t		rc;
+
+		rc = read(fd, HashBuffer, HASH_CHUNK_SIZE);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc < 0)
+			failed = true;
+		if (rc <= 0)
+			break;
+		total += rc;
+		if (total > st->st_size)
+			break;
+		xxh64_update(&state, HashBuffer, rc);
+	}
+	close(fd);
+
+	if (failed || total != st->st_size)
+		return false;
+
+	*hash = xxh64_final(&state);
+	return true;
+}
+
+/*
+ * XXH64, as specified by the xxHash project.  The input is read a byte at
+ * a time so that the result does not depend on alignment or byte order.
+ */
+#define XXH_PRIME64_1	UINT64CONST(0x9E3779B185EBCA87)
+#define XXH_PRIME64_2	UINT64CONST(0xC2B2AE3D27D4EB4F)
+#define XXH_PRIME64_3	UINT64CONST(0x165667B19E3779F9)
+#define XXH_PRIME64_4	UINT64CONST(0x85EBCA77C2B2AE63)
+#define XXH_PRIME64_5	UINT64CONST(0x27D4EB2F165667C5)
+
+#define XXH_ROTL64(x, r)	(((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline uint64
+xxh_read64(const unsigned char *p)
+{
+	return (uint64) p[0] | ((uint64) p[1] << 8) |
+		((uint64) p[2] << 16) | ((uint64) p[3] << 24) |
+		((uint64) p[4] << 32) | ((uint64) p[5] << 40) |
+		((uint64) p[6] << 48) | ((uint64) p[7] << 56);
+}
+
+static inline uint32
+xxh_read32(const unsigned char *p)
+{
+	return (uint32) p[0] | ((uint32) p[1] << 8) |
+		((uint32) p[2] << 16) | ((uint32) p[3] << 24);
+}
+
+static inline uint64
+xxh_round(uint64 acc, uint64 input)
+{
+	acc += input * XXH_PRIME64_2;
+	acc = XXH_ROTL64(acc, 31);
+	return acc * XXH_PRIME64_1;
+}
+
+static inline uint64
+xxh_merge_round(uint64 acc, uint64 val)
+{
+	acc ^= xxh_round(0, val);
+	return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static void
+xxh64_init(XXH64State *state, uint64 seed)
+{
+	state->v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+	state->v2 = seed + XXH_PRIME64_2;
+	state->v3 = seed;
+	state->v4 = seed - XXH_PRIME64_1;
+	state->seed = seed;
+	state->total = 0;
+	state->buflen = 0;
+}
+
+static inline void
+xxh64_stripe(XXH64State *state, const unsigned char *p)
+{
+	state->v1 = xxh_round(state->v1, xxh_read64(p));
+	state->v2 = xxh_round(state->v2, xxh_read64(p + 8));
+	state->v3 = xxh_round(state->v3, xxh_read64(p + 16));
+	state->v4 = xxh_round(state->v4, xxh_read64(p + 24));
+}
+
+/*
+ * Feed len more bytes of input.  Input is consumed in 32-byte stripes; a
+ * partial stripe is kept in state->buf until more arrives.
+ */
+static void
+xxh64_update(XXH64State *state, const void *data, size_t len)
+{
+	const unsigned char *p = (const unsigned char *) data;
+	const unsigned char *end = p + len;
+
+	state->total += len;
+
+	if (state->buflen + len < 32)
+	{
+		memcpy(state->buf + state->buflen, p, len);
+		state->buflen += len;
+		return;
+	}
+
+	if (state->buflen > 0)
+	{
+		size_t		fill = 32 - state->buflen;
+
+		memcpy(state->buf + state->buflen, p, fill);
+		xxh64_stripe(state, state->buf);
+		p += fill;
+		state->buflen = 0;
+	}
+
+	while (p + 32 <= end)
+	{
+		xxh64_stripe(state, p);
+		p += 32;
+	}
+
+	if (p < end)
+	{
+		memcpy(state->buf, p, end - p);
+		state->buflen = end - p;
+	}
+}
+
+static uint64
+xxh64_final(const XXH64State *state)
+{
+	const unsigned char *p = state->buf;
+	const unsigned char *end = p + state->buflen;
+	uint64		h;
+
+	if (state->total >= 32)
+	{
+		h = XXH_ROTL64(state->v1, 1) + XXH_ROTL64(state->v2, 7) +
+			XXH_ROTL64(state->v3, 12) + XXH_ROTL64(state->v4, 18);
+		h = xxh_merge_round(h, state->v1);
+		h = xxh_merge_round(h, state->v2);
+		h = xxh_merge_round(h, state->v3);
+		h = xxh_merge_round(h, state->v4);
+	}
+	else
+		h = state->seed + XXH_PRIME64_5;
+
+	h += state->total;
+
+	while (p + 8 <= end)
+	{
+		h ^= xxh_round(0, xxh_read64(p));
+		h = XXH_ROTL64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+		p += 8;
+	}
+	if (p + 4 <= end)
+	{
+		h ^= (uint64) xxh_read32(p) * XXH_PRIME64_1;
+		h = XXH_ROTL64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		p += 4;
+	}
+	while (p < end)
+	{
+		h ^= (uint64) (*p) * XXH_PRIME64_5;
+		h = XXH_ROTL64(h, 11) * XXH_PRIME64_1;
+		p++;
+	}
+
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	h ^= h >> 32;
+
+	return h;
+}
@@ -0,0 +1,152 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_constants.c
+ *		Expose constants compiled into the server as a system view.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "access/htup.h"
+#include "access/tuptoaster.h"
+#include "storage/lwlock.h"
+#include "utils/builtins.h"
+
+#include "pg_config_int.h"
+
+/*
+ * Values baked into the server by pg_config.h, pg_config_manual.h and the
+ * headers derived from them.  The table is filled in by the compiler; the
+ * module must therefore be built against the same headers as the server,
+ * which PGXS already requires.
+ */
+typedef struct ServerConstant
+{
+	const char *name;
+	int64		value;
+	bool		isbool;			/* report as on/off rather than a number */
+} ServerConstant;
+
+#define NUMERIC_CONSTANT(name)	{#name, (int64) (name), false}
+#define BOOL_CONSTANT(name, value)	{name, value, true}
+
+#ifdef USE_FLOAT4_BYVAL
+#define PGC_FLOAT4_BYVAL 1
+#else
+#define PGC_FLOAT4_BYVAL 0
+#endif
+#ifdef USE_FLOAT8_BYVAL
+#define PGC_FLOAT8_BYVAL 1
+#else
+#define PGC_FLOAT8_BYVAL 0
+#endif
+#ifdef USE_INTEGER_DATETIMES
+#define PGC_INTEGER_DATETIMES 1
+#else
+#define PGC_INTEGER_DATETIMES 0
+#endif
+#ifdef USE_ASSERT_CHECKING
+#define PGC_ASSERT_CHECKING 1
+#else
+#define PGC_ASSERT_CHECKING 0
+#endif
+#ifdef ENABLE_THREAD_SAFETY
+#define PGC_THREAD_SAFETY 1
+#else
+#define PGC_THREAD_SAFETY 0
+#endif
+#ifdef HAVE_SPINLOCKS
+#define PGC_SPINLOCKS 1
+#else
+#define PGC_SPINLOCKS 0
+#endif
+
+static const ServerConstant ServerConstants[] =
+{
+	NUMERIC_CONSTANT(BLCKSZ),
+	NUMERIC_CONSTANT(RELSEG_SIZE),
+	NUMERIC_CONSTANT(XLOG_BLCKSZ),
+	NUMERIC_CONSTANT(XLOG_SEG_SIZE),
+	NUMERIC_CONSTANT(NAMEDATALEN),
+	NUMERIC_CONSTANT(INDEX_MAX_KEYS),
+	NUMERIC_CONSTANT(FUNC_MAX_ARGS),
+	NUMERIC_CONSTANT(MAXIMUM_ALIGNOF),
+	NUMERIC_CONSTANT(ALIGNOF_SHORT),
+	NUMERIC_CONSTANT(ALIGNOF_INT),
+	NUMERIC_CONSTANT(ALIGNOF_LONG),
+	NUMERIC_CONSTANT(ALIGNOF_DOUBLE),
+	NUMERIC_CONSTANT(SIZEOF_SIZE_T),
+	NUMERIC_CONSTANT(SIZEOF_VOID_P),
+	NUMERIC_CONSTANT(TOAST_TUPLE_THRESHOLD),
+	NUMERIC_CONSTANT(TOAST_MAX_CHUNK_SIZE),
+	NUMERIC_CONSTANT(MaxHeapTupleSize),
+	NUMERIC_CONSTANT(MaxHeapTuplesPerPage),
+	NUMERIC_CONSTANT(NUM_BUFFER_PARTITIONS),
+	NUMERIC_CONSTANT(NUM_LOCK_PARTITIONS),
+	NUMERIC_CONSTANT(DEF_PGPORT),
+	BOOL_CONSTANT("FLOAT4PASSBYVAL", PGC_FLOAT4_BYVAL),
+	BOOL_CONSTANT("FLOAT8PASSBYVAL", PGC_FLOAT8_BYVAL),
+	BOOL_CONSTANT("USE_INTEGER_DATETIMES", PGC_INTEGER_DATETIMES),
+	BOOL_CONSTANT("USE_ASSERT_CHECKING", PGC_ASSERT_CHECKING),
+	BOOL_CONSTANT("ENABLE_THREAD_SAFETY", PGC_THREAD_SAFETY),
+	BOOL_CONSTANT("HAVE_SPINLOCKS", PGC_SPINLOCKS),
+	{NULL, 0, false}
+};
+
+Datum pg_config_constants(PG_FUNCTION_ARGS);
+
+/*
+ * pg_config_constants() returns setof (name text, setting text)
+ */
+PG_FUNCTION_INFO_V1(pg_config_constants);
+Datum
+pg_config_constants(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	int					i;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	for (i = 0; ServerConstants[i].name; i++)
+	{
+		Datum		values[2];
+		bool		nulls[2] = {false, false};
+		char		buf[32];
+
+		if (ServerConstants[i].isbool)
+			strlcpy(buf, ServerConstants[i].value ? "on" : "off", sizeof(buf));
+		else
+			snprintf(buf, sizeof(buf), INT64_FORMAT, ServerConstants[i].value);
+
+		values[0] = CStringGetTextDatum(ServerConstants[i].name);
+		values[1] = CStringGetTextDatum(buf);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
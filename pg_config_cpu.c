@@ -0,0 +1,391 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_cpu.c
+ *		Compare the host CPU's instruction set with the build target.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include <ctype.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define USE_CPUID
+#endif
+
+#include "funcapi.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+
+#include "pg_config_int.h"
+
+/*
+ * An instruction set extension that may or may not be used by the build.
+ *
+ * build_enabled comes from the compiler's predefined macros.  This module
+ * is compiled with the server's CFLAGS, so they reflect the -march and -m
+ * switches the server was built with, including the ones implied by
+ * -march.  On x86, cpu support is read from CPUID leaf, register and bit;
+ * elsewhere, and if CPUID is not available, from the cpuinfo name.
+ *
+ * The AVX family also needs the operating system to save and restore the
+ * wider registers, or the instructions fault even though CPUID lists
+ * them; xcr0 holds the XCR0 state bits that must be enabled for that.
+ */
+typedef struct CpuFeature
+{
+	const char *name;			/* name as in /proc/cpuinfo */
+	const char *kind;			/* vector, crc, crypto or bitops */
+	bool		build_enabled;
+	unsigned int leaf;
+	int			reg;			/* CPUID_EBX etc. */
+	int			bit;
+	unsigned int xcr0;			/* XCR0 bits the OS must enable, or 0 */
+} CpuFeature;
+
+#define CPUID_EBX	1
+#define CPUID_ECX	2
+#define CPUID_EDX	3
+
+#define CPUID_1_ECX_OSXSAVE	(1U << 27)
+
+/* XCR0 state components: SSE, AVX (YMM) and the three AVX-512 parts */
+#define XCR0_SSE		(1U << 1)
+#define XCR0_YMM		(1U << 2)
+#define XCR0_AVX		(XCR0_SSE | XCR0_YMM)
+#define XCR0_AVX512		(XCR0_AVX | (1U << 5) | (1U << 6) | (1U << 7))
+
+#ifdef __SSE2__
+#define BUILD_SSE2 true
+#else
+#define BUILD_SSE2 false
+#endif
+#ifdef __SSE3__
+#define BUILD_SSE3 true
+#else
+#define BUILD_SSE3 false
+#endif
+#ifdef __SSSE3__
+#define BUILD_SSSE3 true
+#else
+#define BUILD_SSSE3 false
+#endif
+#ifdef __SSE4_1__
+#define BUILD_SSE4_1 true
+#else
+#define BUILD_SSE4_1 false
+#endif
+#ifdef __SSE4_2__
+#define BUILD_SSE4_2 true
+#else
+#define BUILD_SSE4_2 false
+#endif
+#ifdef __POPCNT__
+#define BUILD_POPCNT true
+#else
+#define BUILD_POPCNT false
+#endif
+#ifdef __AES__
+#define BUILD_AES true
+#else
+#define BUILD_AES false
+#endif
+#ifdef __PCLMUL__
+#define BUILD_PCLMUL true
+#else
+#define BUILD_PCLMUL false
+#endif
+#ifdef __AVX__
+#define BUILD_AVX true
+#else
+#define BUILD_AVX false
+#endif
+#ifdef __FMA__
+#define BUILD_FMA true
+#else
+#define BUILD_FMA false
+#endif
+#ifdef __AVX2__
+#define BUILD_AVX2 true
+#else
+#define BUILD_AVX2 false
+#endif
+#ifdef __BMI__
+#define BUILD_BMI true
+#else
+#define BUILD_BMI false
+#endif
+#ifdef __BMI2__
+#define BUILD_BMI2 true
+#else
+#define BUILD_BMI2 false
+#endif
+#ifdef __AVX512F__
+#define BUILD_AVX512F true
+#else
+#define BUILD_AVX512F false
+#endif
+#ifdef __SHA__
+#define BUILD_SHA true
+#else
+#define BUILD_SHA false
+#endif
+#ifdef __ARM_NEON
+#define BUILD_NEON true
+#else
+#define BUILD_NEON false
+#endif
+#ifdef __ARM_FEATURE_CRC32
+#define BUILD_ARM_CRC32 true
+#else
+#define BUILD_ARM_CRC32 false
+#endif
+#ifdef __ARM_FEATURE_CRYPTO
+#define BUILD_ARM_CRYPTO true
+#else
+#define BUILD_ARM_CRYPTO false
+#endif
+
+static const CpuFeature CpuFeatures[] =
+{
+#if defined(__x86_64__) || defined(__i386__)
+	{"sse2", "vector", BUILD_SSE2, 1, CPUID_EDX, 26, 0},
+	{"pni", "vector", BUILD_SSE3, 1, CPUID_ECX, 0, 0},
+	{"ssse3", "vector", BUILD_SSSE3, 1, CPUID_ECX, 9, 0},
+	{"sse4_1", "vector", BUILD_SSE4_1, 1, CPUID_ECX, 19, 0},
+	{"sse4_2", "crc", BUILD_SSE4_2, 1, CPUID_ECX, 20, 0},
+	{"popcnt", "bitops", BUILD_POPCNT, 1, CPUID_ECX, 23, 0},
+	{"aes", "crypto", BUILD_AES, 1, CPUID_ECX, 25, 0},
+	{"pclmulqdq", "crc", BUILD_PCLMUL, 1, CPUID_ECX, 1, 0},
+	{"avx", "vector", BUILD_AVX, 1, CPUID_ECX, 28, XCR0_AVX},
+	{"fma", "vector", BUILD_FMA, 1, CPUID_ECX, 12, XCR0_AVX},
+	{"avx2", "vector", BUILD_AVX2, 7, CPUID_EBX, 5, XCR0_AVX},
+	{"bmi1", "bitops", BUILD_BMI, 7, CPUID_EBX, 3, 0},
+	{"bmi2", "bitops", BUILD_BMI2, 7, CPUID_EBX, 8, 0},
+	{"avx512f", "vector", BUILD_AVX512F, 7, CPUID_EBX, 16, XCR0_AVX512},
+	{"sha_ni", "crypto", BUILD_SHA, 7, CPUID_EBX, 29, 0},
+#elif defined(__aarch64__) || defined(__arm__)
+	{"asimd", "vector", BUILD_NEON, 0, 0, 0, 0},
+	{"crc32", "crc", BUILD_ARM_CRC32, 0, 0, 0, 0},
+	{"aes", "crypto", BUILD_ARM_CRYPTO, 0, 0, 0, 0},
+	{"pmull", "crc", BUILD_ARM_CRYPTO, 0, 0, 0, 0},
+#endif
+	{NULL, NULL, false, 0, 0, 0, 0}
+};
+
+/*
+ * The cpuinfo feature list, read at most once per backend and only if
+ * CPUID could not answer for some feature.  NULL if not available.
+ */
+static char *CpuInfoFlags = NULL;
+static bool CpuInfoFlagsRead = false;
+
+static bool cpu_has_feature(const CpuFeature *feature, bool *known);
+static const char *get_cpuinfo_flags(void);
+static char *read_cpuinfo_flags(void);
+#ifdef USE_CPUID
+static bool os_enables_state(unsigned int xcr0);
+#endif
+
+Datum pg_config_cpu_features(PG_FUNCTION_ARGS);
+
+/*
+ * pg_config_cpu_features() returns setof (feature text, kind text,
+ *										   cpu_supported bool,
+ *										   build_enabled bool)
+ *
+ * Rows with cpu_supported but not build_enabled are instructions this
+ * host could use if the server were rebuilt for it.  cpu_supported is
+ * NULL if it could not be determined.
+ */
+PG_FUNCTION_INFO_V1(pg_config_cpu_features);
+Datum
+pg_config_cpu_features(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	int					i;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	for (i = 0; CpuFeatures[i].name; i++)
+	{
+		Datum		values[4];
+		bool		nulls[4] = {false, false, false, false};
+		bool		known;
+		bool		supported;
+
+		supported = cpu_has_feature(&CpuFeatures[i], &known);
+
+		values[0] = CStringGetTextDatum(CpuFeatures[i].name);
+		values[1] = CStringGetTextDatum(CpuFeatures[i].kind);
+		values[2] = BoolGetDatum(supported);
+		nulls[2] = !known;
+		values[3] = BoolGetDatum(CpuFeatures[i].build_enabled);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Does the host CPU support feature?  Sets *known to false if we cannot
+ * tell.
+ */
+static bool
+cpu_has_feature(const CpuFeature *feature, bool *known)
+{
+	const char *cpuflags;
+
+	*known = true;
+
+#ifdef USE_CPUID
+	if (feature->leaf <= __get_cpuid_max(0, NULL))
+	{
+		unsigned int eax = 0,
+					ebx = 0,
+					ecx = 0,
+					edx = 0;
+		unsigned int reg;
+
+		__cpuid_count(feature->leaf, 0, eax, ebx, ecx, edx);
+		switch (feature->reg)
+		{
+			case CPUID_EBX:
+				reg = ebx;
+				break;
+			case CPUID_ECX:
+				reg = ecx;
+				break;
+			default:
+				reg = edx;
+				break;
+		}
+		if ((reg & (1U << feature->bit)) == 0)
+			return false;
+		return feature->xcr0 == 0 || os_enables_state(feature->xcr0);
+	}
+#endif
+
+	/* fall back to a whole-word match in the cpuinfo flags line */
+	if ((cpuflags = get_cpuinfo_flags()) != NULL)
+	{
+		size_t		len = strlen(feature->name);
+		const char *p = cpuflags;
+
+		while ((p = strstr(p, feature->name)) != NULL)
+		{
+			if ((p == cpuflags || p[-1] == ' ') &&
+				(p[len] == ' ' || p[len] == '\0'))
+				return true;
+			p += len;
+		}
+		return false;
+	}
+
+	*known = false;
+	return false;
+}
+
+#ifdef USE_CPUID
+/*
+ * Has the operating system enabled all the register state in xcr0?  That
+ * requires OSXSAVE, which also tells us XGETBV is available to read XCR0.
+ */
+static bool
+os_enables_state(unsigned int xcr0)
+{
+	unsigned int eax,
+				ebx,
+				ecx,
+				edx;
+	unsigned int xcr0_lo,
+				xcr0_hi;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+		(ecx & CPUID_1_ECX_OSXSAVE) == 0)
+		return false;
+
+	__asm__ __volatile__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+
+	return (xcr0_lo & xcr0) == xcr0;
+}
+#endif
+
+/*
+ * Return the cached cpuinfo feature list, reading it on first use.
+ */
+static const char *
+get_cpuinfo_flags(void)
+{
+	if (!CpuInfoFlagsRead)
+	{
+		MemoryContext oldcontext;
+
+		oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+		CpuInfoFlags = read_cpuinfo_flags();
+		MemoryContextSwitchTo(oldcontext);
+		CpuInfoFlagsRead = true;
+	}
+
+	return CpuInfoFlags;
+}
+
+/*
+ * Return the feature list from /proc/cpuinfo ("flags" on x86, "Features"
+ * on ARM) for the first processor, or NULL if it is not available.
+ */
+static char *
+read_cpuinfo_flags(void)
+{
+	FILE	   *fp;
+	char		line[4096];
+	char	   *result = NULL;
+
+	if ((fp = AllocateFile("/proc/cpuinfo", "r")) == NULL)
+		return NULL;
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		char	   *colon;
+
+		if (strncmp(line, "flags", 5) != 0 &&
+			strncmp(line, "Features", 8) != 0)
+			continue;
+		if ((colon = strchr(line, ':')) == NULL)
+			continue;
+
+		result = pstrdup(colon + 1);
+		result[strcspn(result, "\n")] = '\0';
+		break;
+	}
+
+	FreeFile(fp);
+
+	return result;
+}
@@ -0,0 +1,638 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_elf.c
+ *		Report build-id and linkage details of the running server binary.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __ELF__
+#include <elf.h>
+#include <sys/mman.h>
+#endif
+
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+
+#include "pg_config_int.h"
+
+#ifdef __ELF__
+
+/* we only ever look at our own executable, so match its word size */
+#if defined(__LP64__) || defined(_LP64)
+#define ELF_CLASS	ELFCLASS64
+typedef Elf64_Ehdr Elf_Ehdr;
+typedef Elf64_Shdr Elf_Shdr;
+typedef Elf64_Sym Elf_Sym;
+typedef Elf64_Dyn Elf_Dyn;
+typedef Elf64_Nhdr Elf_Nhdr;
+#define ELF_ST_TYPE(i)	ELF64_ST_TYPE(i)
+#else
+#define ELF_CLASS	ELFCLASS32
+typedef Elf32_Ehdr Elf_Ehdr;
+typedef Elf32_Shdr Elf_Shdr;
+typedef Elf32_Sym Elf_Sym;
+typedef Elf32_Dyn Elf_Dyn;
+typedef Elf32_Nhdr Elf_Nhdr;
+#define ELF_ST_TYPE(i)	ELF32_ST_TYPE(i)
+#endif
+
+#ifdef WORDS_BIGENDIAN
+#define ELF_DATA	ELFDATA2MSB
+#else
+#define ELF_DATA	ELFDATA2LSB
+#endif
+
+/* the running executable, even after the file on disk was replaced */
+#define PROC_SELF_EXE	"/proc/self/exe"
+
+#ifndef DF_1_PIE
+#define DF_1_PIE	0x08000000
+#endif
+
+/*
+ * A mapped ELF file.  Everything reached through it is bounds-checked
+ * against size before use, since the file is only trusted to be ours.
+ */
+typedef struct ElfImage
+{
+	const char *base;
+	size_t		size;
+	const Elf_Ehdr *ehdr;
+	const Elf_Shdr *shdrs;
+	int			shnum;
+	const Elf_Shdr *shstrtab;
+	char		path[MAXPGPATH];	/* the file that was read, for display */
+} ElfImage;
+
+#define ELF_RANGE_OK(img, off, len) \
+	((Size) (off) <= (img)->size && (Size) (len) <= (img)->size - (Size) (off))
+
+static bool open_running_exec(ElfImage *img, int elevel);
+static bool open_elf_image(const char *path, ElfImage *img, int elevel);
+static void close_elf_image(ElfImage *img);
+static void put_elf_rows(const ElfImage *img,
+			 Tuplestorestate *tupstore, TupleDesc tupdesc);
+static const char *elf_string(const ElfImage *img, const Elf_Shdr *strtab,
+			Size offset);
+static const Elf_Shdr *elf_section(const ElfImage *img, const char *name);
+static const char *elf_build_id(const ElfImage *img, char *buf, Size buflen);
+static const char *elf_frame_pointers(const ElfImage *img,
+				   char *buf, Size buflen);
+static const char *elf_lto(const ElfImage *img);
+static bool has_frame_pointer(const unsigned char *code, Size len);
+
+/* how much of each function to look at for frame pointer setup */
+#define PROLOGUE_LEN	64
+
+#if defined(__x86_64__)
+#define FRAME_MOV		"\x48\x89\xe5"	/* mov %rsp,%rbp */
+#define FRAME_MOV_LEN	3
+#elif defined(__i386__)
+#define FRAME_MOV		"\x89\xe5"		/* mov %esp,%ebp */
+#define FRAME_MOV_LEN	2
+#endif
+
+#endif   /* __ELF__ */
+
+static void put_row(Tuplestorestate *tupstore, TupleDesc tupdesc,
+		const char *name, const char *setting);
+
+Datum pg_config_elf(PG_FUNCTION_ARGS);
+
+/*
+ * pg_config_elf() returns setof (name text, setting text)
+ *
+ * Build-id, shared library dependencies and the properties a profiler
+ * cares about (symbols, debug info, frame pointers) of the postgres
+ * executable this server is running.  Settings that cannot be determined
+ * are NULL.
+ */
+PG_FUNCTION_INFO_V1(pg_config_elf);
+Datum
+pg_config_elf(PG_FUNCTION_ARGS)
+{
+#ifdef __ELF__
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	ElfImage			img;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	open_running_exec(&img, ERROR);
+
+	PG_TRY();
+	{
+		put_elf_rows(&img, tupstore, tupdesc);
+	}
+	PG_CATCH();
+	{
+		close_elf_image(&img);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	close_elf_image(&img);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+#else
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("pg_config_elf() is not supported on this platform")));
+	return (Datum) 0;			/* keep compiler quiet */
+#endif
+}
+
+/*
+ * The GNU build-id of the running postgres executable as a hex string in
+ * buf, or NULL if it has none or can't be read.  Never raises an error.
+ */
+const char *
+pgc_exec_build_id(char *buf, Size buflen)
+{
+#ifdef __ELF__
+	ElfImage	img;
+	const char *result;
+
+	if (!open_running_exec(&img, DEBUG1))
+		return NULL;
+	result = elf_build_id(&img, buf, buflen);
+	close_elf_image(&img);
+	return result;
+#else
+	return NULL;
+#endif
+}
+
+#ifdef __ELF__
+
+/*
+ * Map the executable this process is running.  After a package upgrade
+ * my_exec_path names the new binary, not ours, so on Linux read
+ * /proc/self/exe, which refers to the running inode even once it has been
+ * unlinked; elsewhere, or if that fails, fall back to my_exec_path.
+ * img->path is set to the file actually read.
+ */
+static bool
+open_running_exec(ElfImage *img, int elevel)
+{
+#ifdef __linux__
+	if (open_elf_image(PROC_SELF_EXE, img, DEBUG1))
+	{
+		ssize_t		len;
+
+		/* "... (deleted)" if the file has been replaced since */
+		len = readlink(PROC_SELF_EXE, img->path, sizeof(img->path) - 1);
+		if (len > 0)
+			img->path[len] = '\0';
+		else
+			strlcpy(img->path, PROC_SELF_EXE, sizeof(img->path));
+		return true;
+	}
+#endif
+
+	if (!open_elf_image(my_exec_path, img, elevel))
+		return false;
+	strlcpy(img->path, my_exec_path, sizeof(img->path));
+	return true;
+}
+
+/*
+ * Map the ELF file at path and check its headers.  Problems are reported
+ * at elevel; if that is below ERROR, false is returned instead.
+ */
+static bool
+open_elf_image(const char *path, ElfImage *img, int elevel)
+{
+	struct stat st;
+	int			fd;
+	void	   *base;
+
+	fd = BasicOpenFile((char *) path, O_RDONLY | PG_BINARY, 0);
+	if (fd < 0)
+	{
+		ereport(elevel,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+		return false;
+	}
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		ereport(elevel,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+		return false;
+	}
+	if ((Size) st.st_size < sizeof(Elf_Ehdr))
+	{
+		close(fd);
+		ereport(elevel,
+				(errmsg("file \"%s\" is not an ELF executable", path)));
+		return false;
+	}
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+	{
+		ereport(elevel,
+				(errcode_for_file_access(),
+				 errmsg("could not map file \"%s\": %m", path)));
+		return false;
+	}
+
+	img->base = base;
+	img->size = st.st_size;
+	img->ehdr = (const Elf_Ehdr *) base;
+
+	if (memcmp(img->ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+		img->ehdr->e_ident[EI_CLASS] != ELF_CLASS ||
+		img->ehdr->e_ident[EI_DATA] != ELF_DATA ||
+		img->ehdr->e_shentsize != sizeof(Elf_Shdr) ||
+		!ELF_RANGE_OK(img, img->ehdr->e_shoff,
+					  (Size) img->ehdr->e_shnum * sizeof(Elf_Shdr)) ||
+		img->ehdr->e_shstrndx >= img->ehdr->e_shnum)
+	{
+		munmap(base, st.st_size);
+		ereport(elevel,
+				(errmsg("file \"%s\" is not an ELF executable", path)));
+		return false;
+	}
+	img->shdrs = (const Elf_Shdr *) (img->base + img->ehdr->e_shoff);
+	img->shnum = img->ehdr->e_shnum;
+	img->shstrtab = &img->shdrs[img->ehdr->e_shstrndx];
+
+	return true;
+}
+
+static void
+close_elf_image(ElfImage *img)
+{
+	munmap((void *) img->base, img->size);
+}
+
+static void
+put_elf_rows(const ElfImage *img, Tuplestorestate *tupstore, TupleDesc tupdesc)
+{
+	const Elf_Shdr *dynamic = elf_section(img, ".dynamic");
+	const Elf_Shdr *debuglink;
+	bool		pie = false;
+	char		buf[128];
+
+	put_row(tupstore, tupdesc, "Executable", img->path);
+	put_row(tupstore, tupdesc, "Build ID",
+			elf_build_id(img, buf, sizeof(buf)));
+
+	/*
+	 * A position independent executable is ET_DYN; newer linkers also set
+	 * DF_1_PIE, which tells it apart from a shared library.
+	 */
+	if (img->ehdr->e_type == ET_DYN)
+		pie = true;
+	if (dynamic != NULL &&
+		ELF_RANGE_OK(img, dynamic->sh_offset, dynamic->sh_size))
+	{
+		const Elf_Dyn *dyn = (const Elf_Dyn *) (img->base + dynamic->sh_offset);
+		Size		ndyn = dynamic->sh_size / sizeof(Elf_Dyn);
+		Size		i;
+
+		for (i = 0; i < ndyn && dyn[i].d_tag != DT_NULL; i++)
+		{
+			if (dyn[i].d_tag == DT_FLAGS_1 &&
+				(dyn[i].d_un.d_val & DF_1_PIE) != 0)
+				pie = true;
+		}
+	}
+	put_row(tupstore, tupdesc, "Position independent executable",
+			pie ? "yes" : "no");
+
+	put_row(tupstore, tupdesc, "Symbol table",
+			elf_section(img, ".symtab") != NULL ? "yes" : "no (stripped)");
+
+	debuglink = elf_section(img, ".gnu_debuglink");
+	if (elf_section(img, ".debug_info") != NULL)
+		put_row(tupstore, tupdesc, "Debug information", "yes");
+	else if (debuglink != NULL &&
+			 ELF_RANGE_OK(img, debuglink->sh_offset, debuglink->sh_size) &&
+			 debuglink->sh_size > 0)
+	{
+		snprintf(buf, sizeof(buf), "separate (%.*s)",
+				 (int) strnlen(img->base + debuglink->sh_offset,
+							   debuglink->sh_size),
+				 img->base + debuglink->sh_offset);
+		put_row(tupstore, tupdesc, "Debug information", buf);
+	}
+	else
+		put_row(tupstore, tupdesc, "Debug information", "no");
+
+	put_row(tupstore, tupdesc, "Frame pointers",
+			elf_frame_pointers(img, buf, sizeof(buf)));
+	put_row(tupstore, tupdesc, "Link-time optimization", elf_lto(img));
+
+	/* DT_NEEDED entries are offsets into the section .dynamic links to */
+	if (dynamic != NULL &&
+		ELF_RANGE_OK(img, dynamic->sh_offset, dynamic->sh_size) &&
+		dynamic->sh_link < img->shnum)
+	{
+		const Elf_Dyn *dyn = (const Elf_Dyn *) (img->base + dynamic->sh_offset);
+		const Elf_Shdr *dynstr = &img->shdrs[dynamic->sh_link];
+		Size		ndyn = dynamic->sh_size / sizeof(Elf_Dyn);
+		Size		i;
+
+		for (i = 0; i < ndyn && dyn[i].d_tag != DT_NULL; i++)
+		{
+			const char *lib;
+
+			if (dyn[i].d_tag != DT_NEEDED)
+				continue;
+			lib = elf_string(img, dynstr, dyn[i].d_un.d_val);
+			if (lib != NULL)
+				put_row(tupstore, tupdesc, "Needed library", lib);
+		}
+	}
+}
+
+/*
+ * Return the NUL-terminated string at offset in a string table section,
+ * or NULL if it does not lie entirely inside the section.
+ */
+static const char *
+elf_string(const ElfImage *img, const Elf_Shdr *strtab, Size offset)
+{
+	const char *str;
+
+	if (!ELF_RANGE_OK(img, strtab->sh_offset, strtab->sh_size) ||
+		offset >= strtab->sh_size)
+		return NULL;
+	str = img->base + strtab->sh_offset + offset;
+	if (memchr(str, '\0', strtab->sh_size - offset) == NULL)
+		return NULL;
+	return str;
+}
+
+/*
+ * Find a section by name.  Sections of type SHT_NOBITS have no contents
+ * in the file and are never returned.
+ */
+static const Elf_Shdr *
+elf_section(const ElfImage *img, const char *name)
+{
+	int			i;
+
+	for (i = 0; i < img->shnum; i++)
+	{
+		const char *secname = elf_string(img, img->shstrtab,
+										 img->shdrs[i].sh_name);
+
+		if (secname != NULL && strcmp(secname, name) == 0 &&
+			img->shdrs[i].sh_type != SHT_NOBITS)
+			return &img->shdrs[i];
+	}
+	return NULL;
+}
+
+/*
+ * The GNU build-id as a hex string in buf, or NULL if there is none.
+ */
+static const char *
+elf_build_id(const ElfImage *img, char *buf, Size buflen)
+{
+	const Elf_Shdr *note = elf_section(img, ".note.gnu.build-id");
+	const Elf_Nhdr *nhdr;
+	const unsigned char *desc;
+	Size		namesz;
+	Size		i;
+
+	if (note == NULL ||
+		!ELF_RANGE_OK(img, note->sh_offset, note->sh_size) ||
+		note->sh_size < sizeof(Elf_Nhdr))
+		return NULL;
+
+	nhdr = (const Elf_Nhdr *) (img->base + note->sh_offset);
+	namesz = TYPEALIGN(4, nhdr->n_namesz);
+	if (nhdr->n_type != NT_GNU_BUILD_ID ||
+		sizeof(Elf_Nhdr) + namesz + nhdr->n_descsz > note->sh_size ||
+		nhdr->n_descsz * 2 >= buflen)
+		return NULL;
+
+	desc = (const unsigned char *) nhdr + sizeof(Elf_Nhdr) + namesz;
+	for (i = 0; i < nhdr->n_descsz; i++)
+		sprintf(buf + i * 2, "%02x", desc[i]);
+	return buf;
+}
+
+/*
+ * There is no flag recording -fno-omit-frame-pointer, so look at the
+ * prologue of every function in the symbol table and count how many set
+ * up a frame pointer.  NULL if we can't tell for this architecture or
+ * there are no symbols.
+ */
+static const char *
+elf_frame_pointers(const ElfImage *img, char *buf, Size buflen)
+{
+	const Elf_Shdr *symtab = elf_section(img, ".symtab");
+	const Elf_Sym *syms;
+	Size		nsyms;
+	Size		i;
+	long		nfuncs = 0;
+	long		nframes = 0;
+
+#if !defined(__x86_64__) && !defined(__i386__) && !defined(__aarch64__)
+	return NULL;
+#endif
+
+	/* stripped binaries still export most functions, thanks to -E */
+	if (symtab == NULL)
+		symtab = elf_section(img, ".dynsym");
+	if (symtab == NULL ||
+		!ELF_RANGE_OK(img, symtab->sh_offset, symtab->sh_size))
+		return NULL;
+
+	syms = (const Elf_Sym *) (img->base + symtab->sh_offset);
+	nsyms = symtab->sh_size / sizeof(Elf_Sym);
+	for (i = 0; i < nsyms; i++)
+	{
+		const Elf_Shdr *text;
+		Size		offset;
+		Size		len;
+
+		if (ELF_ST_TYPE(syms[i].st_info) != STT_FUNC ||
+			syms[i].st_size < 16 ||
+			syms[i].st_shndx == SHN_UNDEF ||
+			syms[i].st_shndx >= img->shnum)
+			continue;
+		len = Min(syms[i].st_size, PROLOGUE_LEN);
+
+		/* map the function's address back to its place in the file */
+		text = &img->shdrs[syms[i].st_shndx];
+		if (text->sh_type != SHT_PROGBITS ||
+			syms[i].st_value < text->sh_addr ||
+			syms[i].st_value - text->sh_addr + len > text->sh_size)
+			continue;
+		offset = text->sh_offset + (syms[i].st_value - text->sh_addr);
+		if (!ELF_RANGE_OK(img, offset, len))
+			continue;
+
+		nfuncs++;
+		if (has_frame_pointer((const unsigned char *) img->base + offset, len))
+			nframes++;
+	}
+
+	if (nfuncs == 0)
+		return NULL;
+
+	/* leaf functions may legitimately skip the frame even when enabled */
+	snprintf(buf, buflen, "%s (%ld of %ld functions)",
+			 nframes * 2 >= nfuncs ? "yes" : "no", nframes, nfuncs);
+	return buf;
+}
+
+/*
+ * Does the code at the start of a function set up a frame pointer?
+ */
+static bool
+has_frame_pointer(const unsigned char *code, Size len)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	Size		i;
+
+	/* skip endbr64/endbr32 */
+	if (len >= 4 && code[0] == 0xf3 && code[1] == 0x0f && code[2] == 0x1e &&
+		(code[3] == 0xfa || code[3] == 0xfb))
+	{
+		code += 4;
+		len -= 4;
+	}
+
+	/*
+	 * push %rbp comes first, but the compiler is free to schedule the
+	 * mov %rsp,%rbp that makes it a frame pointer a few instructions later.
+	 * Code that merely uses %rbp as a callee-saved register never has it.
+	 */
+	if (len < 1 || code[0] != 0x55)
+		return false;
+	for (i = 1; i + FRAME_MOV_LEN <= len; i++)
+	{
+		if (memcmp(code + i, FRAME_MOV, FRAME_MOV_LEN) == 0)
+			return true;
+	}
+	return false;
+#elif defined(__aarch64__)
+	Size		i;
+
+	/* mov x29, sp within the first few instructions */
+	for (i = 0; i + 4 <= len; i += 4)
+	{
+		uint32		insn;
+
+		memcpy(&insn, code + i, sizeof(insn));
+		if (insn == 0x910003fd)
+			return true;
+	}
+	return false;
+#else
+	return false;
+#endif
+}
+
+/*
+ * Both GCC and clang rename file-local symbols when they are promoted
+ * across translation units during link-time optimization, so their
+ * suffixes are left behind in the symbol table.  With debug info, GCC
+ * also names the compilation units it produced from LTO bytecode
+ * "GNU GIMPLE".  NULL if there is nothing to look at.
+ */
+static const char *
+elf_lto(const ElfImage *img)
+{
+	const Elf_Shdr *symtab = elf_section(img, ".symtab");
+	const Elf_Shdr *debugstr = elf_section(img, ".debug_str");
+	static const char gimple[] = "GNU GIMPLE";
+
+	if (debugstr != NULL &&
+		ELF_RANGE_OK(img, debugstr->sh_offset, debugstr->sh_size))
+	{
+		const char *p = img->base + debugstr->sh_offset;
+		const char *end = p + debugstr->sh_size;
+
+		/* the section is a sequence of NUL-terminated strings */
+		while (p < end)
+		{
+			Size		len = strnlen(p, end - p);
+
+			if (len >= sizeof(gimple) - 1 &&
+				strncmp(p, gimple, sizeof(gimple) - 1) == 0)
+				return "yes";
+			p += len + 1;
+		}
+	}
+
+	if (symtab != NULL &&
+		ELF_RANGE_OK(img, symtab->sh_offset, symtab->sh_size) &&
+		symtab->sh_link < img->shnum)
+	{
+		const Elf_Sym *syms = (const Elf_Sym *) (img->base + symtab->sh_offset);
+		const Elf_Shdr *strtab = &img->shdrs[symtab->sh_link];
+		Size		nsyms = symtab->sh_size / sizeof(Elf_Sym);
+		Size		i;
+
+		for (i = 0; i < nsyms; i++)
+		{
+			const char *name = elf_string(img, strtab, syms[i].st_name);
+
+			if (name != NULL &&
+				(strstr(name, ".lto_priv.") != NULL ||
+				 strstr(name, ".llvm.") != NULL))
+				return "yes";
+		}
+		return "no";
+	}
+
+	return debugstr != NULL ? "no" : NULL;
+}
+
+#endif   /* __ELF__ */
+
+static void
+put_row(Tuplestorestate *tupstore, TupleDesc tupdesc,
+		const char *name, const char *setting)
+{
+	Datum		values[2];
+	bool		nulls[2] = {false, false};
+
+	values[0] = CStringGetTextDatum(name);
+	if (setting != NULL)
+		values[1] = CStringGetTextDatum(setting);
+	else
+		nulls[1] = true;
+
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+}
@@ -0,0 +1,330 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_extensions.c
+ *		Inventory of the extensions and modules installed on the server.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include <ctype.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+#include "pg_config_int.h"
+
+/*
+ * One installed file.
+ */
+typedef struct InstalledFile
+{
+	char	   *name;			/* file name less the suffix */
+	char	   *version;		/* default_version, or NULL */
+	char	   *path;
+	int64		size;
+	time_t		mtime;
+} InstalledFile;
+
+/*
+ * The directories we look in, each with its own cache.  A directory's
+ * mtime changes whenever a file in it is added, removed or renamed into
+ * place, which is how make install replaces files, so the listing is kept
+ * until it does.  As for the control file, the cache is only trusted if it
+ * was read in a later second than the directory was last changed.
+ */
+typedef struct InventoryDir
+{
+	const char *setting;		/* ConfigData setting for the base directory */
+	const char *subdir;			/* subdirectory of it, or NULL */
+	const char *kind;			/* what the files are */
+	const char *suffix;			/* which files to list */
+
+	MemoryContext context;		/* holds files[] and its strings */
+	InstalledFile *files;
+	int			nfiles;
+	bool		valid;
+	struct stat st;				/* directory, as last read */
+	time_t		readtime;
+} InventoryDir;
+
+/* install generation all of InventoryDirs were last validated at */
+static uint32 InventoryGeneration = 0;
+
+#define INVENTORY_DIR(setting, subdir, kind, suffix) \
+	{setting, subdir, kind, suffix, NULL, NULL, 0, false, {0}, 0}
+
+static InventoryDir InventoryDirs[] =
+{
+	INVENTORY_DIR("SHAREDIR", "extension", "control", ".control"),
+	INVENTORY_DIR("SHAREDIR", "contrib", "script", ".sql"),
+	INVENTORY_DIR("PKGLIBDIR", NULL, "module", DLSUFFIX),
+};
+
+static void load_inventory_dir(InventoryDir *idir);
+static char *read_default_version(const char *path);
+static int	installed_file_cmp(const void *a, const void *b);
+
+Datum pg_config_extensions(PG_FUNCTION_ARGS);
+
+/*
+ * pg_config_extensions() returns setof (kind text, name text,
+ *										 version text, path text,
+ *										 size bigint, mtime timestamptz)
+ *
+ * Extension control files in SHAREDIR/extension, contrib install scripts
+ * in SHAREDIR/contrib, and loadable modules in PKGLIBDIR.
+ */
+PG_FUNCTION_INFO_V1(pg_config_extensions);
+Datum
+pg_config_extensions(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	bool				unchanged;
+	int					d;
+	int					i;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	/* with the directories unchanged, there is no need to stat them */
+	unchanged = pgc_install_unchanged(&InventoryGeneration);
+
+	for (d = 0; d < lengthof(InventoryDirs); d++)
+	{
+		InventoryDir *idir = &InventoryDirs[d];
+
+		if (!unchanged || !idir->valid)
+			load_inventory_dir(idir);
+
+		for (i = 0; i < idir->nfiles; i++)
+		{
+			InstalledFile *file = &idir->files[i];
+			Datum		values[6];
+			bool		nulls[6] = {false, false, false, false, false, false};
+
+			values[0] = CStringGetTextDatum(idir->kind);
+			values[1] = CStringGetTextDatum(file->name);
+			if (file->version)
+				values[2] = CStringGetTextDatum(file->version);
+			else
+				nulls[2] = true;
+			values[3] = CStringGetTextDatum(file->path);
+			values[4] = Int64GetDatum(file->size);
+			values[5] = TimestampTzGetDatum(time_t_to_timestamptz(file->mtime));
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Make sure idir->files[] reflects the current contents of the directory.
+ * A directory that does not exist has no files.
+ */
+static void
+load_inventory_dir(InventoryDir *idir)
+{
+	char		dirpath[MAXPGPATH];
+	struct stat st;
+	MemoryContext oldcontext;
+	DIR		   *dir;
+	struct dirent *de;
+	int			maxfiles;
+	Size		suffixlen = strlen(idir->suffix);
+
+	if (idir->subdir)
+		snprintf(dirpath, sizeof(dirpath), "%s/%s",
+				 pg_config_get_setting(idir->setting), idir->subdir);
+	else
+		strlcpy(dirpath, pg_config_get_setting(idir->setting),
+				sizeof(dirpath));
+
+	/*
+	 * Watch the directory before looking at it, so that changes after this
+	 * point are seen.  A directory created since the watches were opened
+	 * only gets one here, when its creation makes us look again.
+	 */
+	pgc_install_watch(dirpath);
+
+	if (stat(dirpath, &st) < 0)
+	{
+		if (errno != ENOENT)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not stat directory \"%s\": %m", dirpath)));
+		MemSet(&st, 0, sizeof(st));
+	}
+
+	if (idir->valid &&
+		st.st_dev == idir->st.st_dev &&
+		st.st_ino == idir->st.st_ino &&
+		st.st_mtime == idir->st.st_mtime &&
+		idir->readtime > st.st_mtime)
+		return;
+
+	idir->valid = false;
+	if (idir->context == NULL)
+		idir->context = AllocSetContextCreate(TopMemoryContext,
+											  "pg_config extension inventory",
+											  ALLOCSET_SMALL_MINSIZE,
+											  ALLOCSET_SMALL_INITSIZE,
+											  ALLOCSET_SMALL_MAXSIZE);
+	else
+		MemoryContextReset(idir->context);
+	idir->files = NULL;
+	idir->nfiles = 0;
+	idir->readtime = time(NULL);
+
+	if (st.st_ino == 0)
+	{
+		/* directory is missing */
+		idir->st = st;
+		idir->valid = true;
+		return;
+	}
+
+	oldcontext = MemoryContextSwitchTo(idir->context);
+
+	maxfiles = 32;
+	idir->files = palloc(maxfiles * sizeof(InstalledFile));
+
+	dir = AllocateDir(dirpath);
+	if (dir == NULL)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open directory \"%s\": %m", dirpath)));
+
+	while ((de = ReadDir(dir, dirpath)) != NULL)
+	{
+		Size		namelen = strlen(de->d_name);
+		char		path[MAXPGPATH];
+		struct stat fst;
+		InstalledFile *file;
+
+		if (namelen <= suffixlen ||
+			strcmp(de->d_name + namelen - suffixlen, idir->suffix) != 0)
+			continue;
+		/* contrib ships an uninstall script alongside each install script */
+		if (strncmp(de->d_name, "uninstall_", 10) == 0)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", dirpath, de->d_name);
+		if (stat(path, &fst) < 0 || !S_ISREG(fst.st_mode))
+			continue;
+
+		if (idir->nfiles >= maxfiles)
+		{
+			maxfiles *= 2;
+			idir->files = repalloc(idir->files,
+								   maxfiles * sizeof(InstalledFile));
+		}
+		file = &idir->files[idir->nfiles++];
+		file->name = pnstrdup(de->d_name, namelen - suffixlen);
+		file->path = pstrdup(path);
+		file->size = (int64) fst.st_size;
+		file->mtime = fst.st_mtime;
+		file->version = NULL;
+		if (strcmp(idir->suffix, ".control") == 0)
+			file->version = read_default_version(path);
+	}
+
+	FreeDir(dir);
+
+	qsort(idir->files, idir->nfiles, sizeof(InstalledFile),
+		  installed_file_cmp);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	idir->st = st;
+	idir->valid = true;
+}
+
+/*
+ * Return the default_version set in an extension control file, or NULL.
+ * Control files are short lines of name = 'value', with # comments.
+ */
+static char *
+read_default_version(const char *path)
+{
+	FILE	   *fp;
+	char		line[MAXPGPATH];
+	char	   *version = NULL;
+
+	if ((fp = AllocateFile(path, "r")) == NULL)
+		return NULL;
+
+	while (version == NULL && fgets(line, sizeof(line), fp) != NULL)
+	{
+		char	   *p = line;
+		char	   *end;
+
+		while (isspace((unsigned char) *p))
+			p++;
+		if (strncmp(p, "default_version", 15) != 0 ||
+			(p[15] != '=' && !isspace((unsigned char) p[15])))
+			continue;
+		p += 15;
+		while (isspace((unsigned char) *p))
+			p++;
+		if (*p == '=')
+			p++;
+		while (isspace((unsigned char) *p))
+			p++;
+
+		if (*p == '\'')
+		{
+			p++;
+			end = strchr(p, '\'');
+		}
+		else
+		{
+			end = p;
+			while (*end && !isspace((unsigned char) *end) && *end != '#')
+				end++;
+		}
+		if (end != NULL && end > p)
+			version = pnstrdup(p, end - p);
+	}
+
+	FreeFile(fp);
+
+	return version;
+}
+
+static int
+installed_file_cmp(const void *a, const void *b)
+{
+	return strcmp(((const InstalledFile *) a)->name,
+				  ((const InstalledFile *) b)->name);
+}
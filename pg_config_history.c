@@ -0,0 +1,310 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_history.c
+ *		Keep a bounded history of control data and build identity.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/ipc.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/builtins.h"
+#include "utils/timestamp.h"
+
+#include "pg_config_int.h"
+
+/*
+ * A sample of the things worth having a history of: where the last
+ * checkpoint was and on which timeline, whether the settings changed, and
+ * which executable the server was running.
+ */
+typedef struct HistorySample
+{
+	TimestampTz sample_time;
+	DBState		state;
+	TimeLineID	timeline;
+	XLogRecPtr	checkpoint;
+	XLogRecPtr	redo;
+	pg_time_t	checkpoint_time;
+	char		settings_hash[33];	/* pg_config_fingerprint() */
+	char		build_id[65];	/* hex, or empty if unknown */
+} HistorySample;
+
+/*
+ * Samples live in a fixed ring in shared memory, so memory stays bounded
+ * and the oldest sample is simply overwritten.  Each slot has a sequence
+ * counter that is odd while the slot is being written; readers copy a
+ * slot without holding anything and keep the copy only if the counter was
+ * even and unchanged across it.  The spinlock is held just to claim a
+ * slot or read a counter, which also gives us the memory ordering that a
+ * lock-free ring would otherwise need barriers for, so a reader can never
+ * hold up a writer for more than a few instructions.
+ */
+typedef struct HistorySlot
+{
+	uint32		seq;
+	uint64		pos;			/* which sample this slot holds */
+	HistorySample sample;
+} HistorySlot;
+
+typedef struct HistoryRing
+{
+	slock_t		mutex;
+	uint64		next;			/* number of samples ever claimed */
+	TimestampTz last_sample;	/* when the latest sample was claimed */
+	int			nslots;
+	HistorySlot slots[1];		/* VARIABLE LENGTH ARRAY */
+} HistoryRing;
+
+/* GUC variables */
+int			pgc_history_size = 256;
+int			pgc_history_interval = 60;
+
+static HistoryRing *pgc_history = NULL;
+
+static void maybe_sample(bool force);
+static void take_sample(HistorySample *sample);
+static HistoryRing *get_history(void);
+
+Datum pg_config_history(PG_FUNCTION_ARGS);
+Datum pg_config_history_sample(PG_FUNCTION_ARGS);
+
+/*
+ * Estimate shared memory space needed.
+ */
+Size
+pgc_history_memsize(void)
+{
+	return add_size(offsetof(HistoryRing, slots),
+					mul_size(pgc_history_size, sizeof(HistorySlot)));
+}
+
+/*
+ * Allocate and initialize the ring.  Called from the shmem_startup hook
+ * with AddinShmemInitLock held.
+ */
+void
+pgc_history_shmem_init(void)
+{
+	bool		found;
+
+	pgc_history = ShmemInitStruct("pg_config history",
+								  pgc_history_memsize(), &found);
+	if (!found)
+	{
+		SpinLockInit(&pgc_history->mutex);
+		pgc_history->next = 0;
+		pgc_history->last_sample = 0;
+		pgc_history->nslots = pgc_history_size;
+		MemSet(pgc_history->slots, 0,
+			   pgc_history_size * sizeof(HistorySlot));
+	}
+}
+
+/*
+ * pg_config_history() returns setof (sample_time timestamptz,
+ *									  state text, timeline int,
+ *									  checkpoint_location text,
+ *									  redo_location text,
+ *									  checkpoint_time timestamptz,
+ *									  settings_hash text, build_id text)
+ *
+ * The samples in the ring, oldest first.  There is no process to take
+ * samples on a timer, so reading the history first adds a sample if the
+ * latest one is older than pg_config.history_interval; anything that
+ * polls the view therefore keeps it filled.
+ */
+PG_FUNCTION_INFO_V1(pg_config_history);
+Datum
+pg_config_history(PG_FUNCTION_ARGS)
+{
+	volatile HistoryRing *ring = get_history();
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	uint64				next;
+	uint64				pos;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	maybe_sample(false);
+
+	SpinLockAcquire(&ring->mutex);
+	next = ring->next;
+	SpinLockRelease(&ring->mutex);
+
+	pos = next > (uint64) ring->nslots ? next - ring->nslots : 0;
+	for (; pos < next; pos++)
+	{
+		volatile HistorySlot *slot = &ring->slots[pos % ring->nslots];
+		HistorySample sample;
+		uint32		before;
+		uint32		after;
+		uint64		slotpos;
+		TimestampTz ckpt_time;
+		Datum		values[8];
+		bool		nulls[8] = {false, false, false, false,
+								false, false, false, false};
+		char		buf[64];
+
+		SpinLockAcquire(&ring->mutex);
+		before = slot->seq;
+		slotpos = slot->pos;
+		SpinLockRelease(&ring->mutex);
+
+		memcpy(&sample, (const HistorySample *) &slot->sample, sizeof(sample));
+
+		SpinLockAcquire(&ring->mutex);
+		after = slot->seq;
+		SpinLockRelease(&ring->mutex);
+
+		/* being written, overwritten while we copied it, or already reused */
+		if ((before & 1) != 0 || before != after || slotpos != pos)
+			continue;
+
+		values[0] = TimestampTzGetDatum(sample.sample_time);
+		values[1] = CStringGetTextDatum(pgc_dbstate_name(sample.state));
+		values[2] = Int32GetDatum((int32) sample.timeline);
+		snprintf(buf, sizeof(buf), "%X/%X",
+				 sample.checkpoint.xlogid, sample.checkpoint.xrecoff);
+		values[3] = CStringGetTextDatum(buf);
+		snprintf(buf, sizeof(buf), "%X/%X",
+				 sample.redo.xlogid, sample.redo.xrecoff);
+		values[4] = CStringGetTextDatum(buf);
+		ckpt_time = time_t_to_timestamptz((time_t) sample.checkpoint_time);
+		values[5] = TimestampTzGetDatum(ckpt_time);
+		values[6] = CStringGetTextDatum(sample.settings_hash);
+		if (sample.build_id[0] != '\0')
+			values[7] = CStringGetTextDatum(sample.build_id);
+		else
+			nulls[7] = true;
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * pg_config_history_sample() returns void
+ *
+ * Add a sample now, regardless of pg_config.history_interval.
+ */
+PG_FUNCTION_INFO_V1(pg_config_history_sample);
+Datum
+pg_config_history_sample(PG_FUNCTION_ARGS)
+{
+	get_history();
+	maybe_sample(true);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Add a sample to the ring if one is due, or if force is set.
+ */
+static void
+maybe_sample(bool force)
+{
+	volatile HistoryRing *ring = pgc_history;
+	volatile HistorySlot *slot;
+	HistorySample sample;
+	TimestampTz now = GetCurrentTimestamp();
+	TimestampTz prev;
+
+	/*
+	 * Claim the interval first, so that concurrent readers of the view
+	 * don't all take the same sample.  If taking it fails, give the claim
+	 * back, or nobody would sample again until the interval had passed.
+	 */
+	SpinLockAcquire(&ring->mutex);
+	if (!force && ring->next > 0 &&
+		!TimestampDifferenceExceeds(ring->last_sample, now,
+									pgc_history_interval * 1000))
+	{
+		SpinLockRelease(&ring->mutex);
+		return;
+	}
+	prev = ring->last_sample;
+	ring->last_sample = now;
+	SpinLockRelease(&ring->mutex);
+
+	PG_TRY();
+	{
+		take_sample(&sample);
+	}
+	PG_CATCH();
+	{
+		SpinLockAcquire(&ring->mutex);
+		if (ring->last_sample == now)
+			ring->last_sample = prev;
+		SpinLockRelease(&ring->mutex);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	SpinLockAcquire(&ring->mutex);
+	slot = &ring->slots[ring->next % ring->nslots];
+	slot->pos = ring->next++;
+	slot->seq++;
+	SpinLockRelease(&ring->mutex);
+
+	memcpy((HistorySample *) &slot->sample, &sample, sizeof(sample));
+
+	SpinLockAcquire(&ring->mutex);
+	slot->seq++;
+	SpinLockRelease(&ring->mutex);
+}
+
+static void
+take_sample(HistorySample *sample)
+{
+	const ControlFileData *cf = pgc_controlfile();
+
+	MemSet(sample, 0, sizeof(HistorySample));
+	sample->sample_time = GetCurrentTimestamp();
+	sample->state = cf->state;
+	sample->timeline = cf->checkPointCopy.ThisTimeLineID;
+	sample->checkpoint = cf->checkPoint;
+	sample->redo = cf->checkPointCopy.redo;
+	sample->checkpoint_time = cf->checkPointCopy.time;
+	strlcpy(sample->settings_hash, pg_config_get_fingerprint(),
+			sizeof(sample->settings_hash));
+	if (pgc_exec_build_id(sample->build_id, sizeof(sample->build_id)) == NULL)
+		sample->build_id[0] = '\0';
+}
+
+static HistoryRing *
+get_history(void)
+{
+	if (pgc_history == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_config must be loaded via shared_preload_libraries")));
+	return pgc_history;
+}
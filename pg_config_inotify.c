@@ -0,0 +1,214 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_inotify.c
+ *		Notice changes to the installation directories with inotify.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "pg_config_int.h"
+
+/*
+ * The caches of installed files (binary hashes, the extension inventory,
+ * Makefile.global) otherwise revalidate by stat()ing every file or
+ * directory on each call.  With pg_config.watch_install on, the first
+ * check in a backend opens an inotify instance watching the installation
+ * directories, and later checks just drain it with one non-blocking
+ * read(): InstallGeneration moves whenever anything was reported, and a
+ * cache stamped with the current generation is still good.
+ *
+ * The watches are per backend, since there is no process that could keep
+ * them on everyone's behalf.  That also means one inotify instance per
+ * backend using these functions, which counts against the per-user
+ * fs.inotify.max_user_instances limit, and one watch per directory against
+ * fs.inotify.max_user_watches.  If either runs out, or on platforms
+ * without inotify, the caches simply fall back to stat() for the rest of
+ * the backend's life.
+ */
+bool		pgc_watch_install = false;
+
+#ifdef __linux__
+#define WATCH_MASK	(IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | \
+					 IN_DELETE_SELF | IN_MODIFY | IN_MOVE_SELF | \
+					 IN_MOVED_FROM | IN_MOVED_TO)
+
+static int	InstallWatchFd = -1;
+static bool InstallWatchFailed = false;
+#endif
+static uint32 InstallGeneration = 1;
+
+#ifdef __linux__
+static bool open_install_watch(void);
+static void close_install_watch(void);
+#endif
+
+/*
+ * Report whether the installation directories are unchanged since the
+ * caller last stamped its cache with *generation, and stamp it with the
+ * current generation.  Returns false whenever we can't tell, so the
+ * caller should then revalidate the way it would without watches.
+ *
+ * A caller that fails partway through rebuilding its cache must not trust
+ * the stamp; keeping its own valid flag takes care of that.
+ */
+bool
+pgc_install_unchanged(uint32 *generation)
+{
+#ifdef __linux__
+	union
+	{
+		struct inotify_event ev;
+		char		buf[4096];
+	}			events;
+	ssize_t		len;
+	bool		changed = false;
+
+	if (!pgc_watch_install || InstallWatchFailed ||
+		(InstallWatchFd < 0 && !open_install_watch()))
+	{
+		*generation = 0;
+		return false;
+	}
+
+	while ((len = read(InstallWatchFd, events.buf, sizeof(events.buf))) > 0)
+	{
+		char	   *p = events.buf;
+
+		changed = true;
+
+		/*
+		 * A removed watch or lost events leave us unable to vouch for
+		 * anything, so start over with fresh watches.
+		 */
+		while (p < events.buf + len)
+		{
+			struct inotify_event *ev = (struct inotify_event *) p;
+
+			if (ev->mask & (IN_IGNORED | IN_Q_OVERFLOW))
+			{
+				close_install_watch();
+				InstallGeneration++;
+				*generation = 0;
+				return false;
+			}
+			p += sizeof(struct inotify_event) + ev->len;
+		}
+	}
+	if (len < 0 && errno != EAGAIN && errno != EINTR)
+	{
+		close_install_watch();
+		InstallGeneration++;
+		*generation = 0;
+		return false;
+	}
+
+	if (changed)
+		InstallGeneration++;
+	if (*generation == InstallGeneration)
+		return true;
+	*generation = InstallGeneration;
+	return false;
+#else
+	*generation = 0;
+	return false;
+#endif
+}
+
+/*
+ * Add a directory to the watch list, if watching.  Callers that walk
+ * subdirectories add each one before reading it.
+ */
+void
+pgc_install_watch(const char *path)
+{
+#ifdef __linux__
+	if (InstallWatchFd >= 0 &&
+		inotify_add_watch(InstallWatchFd, path, WATCH_MASK) < 0 &&
+		errno != ENOENT)
+	{
+		/*
+		 * Can't see this one, so can't vouch for anything.  Retrying would
+		 * most likely fail the same way, typically with ENOSPC once
+		 * fs.inotify.max_user_watches is used up, after re-adding every
+		 * other watch on each call; give up for this backend instead.
+		 */
+		ereport(LOG,
+				(errmsg("could not watch directory \"%s\": %m", path),
+				 errdetail("Changes to the installation will be detected by polling.")));
+		close_install_watch();
+		InstallWatchFailed = true;
+		InstallGeneration++;
+	}
+#endif
+}
+
+#ifdef __linux__
+/*
+ * Open the inotify instance and watch the top-level directories.
+ * Directories that don't exist yet are skipped here.  Creating one is
+ * reported by the watch on its parent, and the rescan that follows adds
+ * the watch: every cache calls pgc_install_watch() on each directory it
+ * is about to read.
+ */
+static bool
+open_install_watch(void)
+{
+	char		path[MAXPGPATH];
+
+	InstallWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (InstallWatchFd < 0)
+	{
+		ereport(LOG,
+				(errmsg("could not create inotify instance: %m"),
+				 errdetail("Changes to the installation will be detected by polling.")));
+		InstallWatchFailed = true;
+		return false;
+	}
+
+	pgc_install_watch(pg_config_get_setting("BINDIR"));
+	pgc_install_watch(pg_config_get_setting("PKGLIBDIR"));
+	pgc_install_watch(pg_config_get_setting("SHAREDIR"));
+	snprintf(path, sizeof(path), "%s/extension",
+			 pg_config_get_setting("SHAREDIR"));
+	pgc_install_watch(path);
+	snprintf(path, sizeof(path), "%s/contrib",
+			 pg_config_get_setting("SHAREDIR"));
+	pgc_install_watch(path);
+
+	return InstallWatchFd >= 0;
+}
+
+static void
+close_install_watch(void)
+{
+	if (InstallWatchFd >= 0)
+		close(InstallWatchFd);
+	InstallWatchFd = -1;
+}
+#endif   /* __linux__ */
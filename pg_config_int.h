@@ -0,0 +1,71 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_int.h
+ *		Declarations shared by the pg_config source files.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+#ifndef PG_CONFIG_INT_H
+#define PG_CONFIG_INT_H
+
+#include "fmgr.h"
+#include "access/tupdesc.h"
+#include "catalog/pg_control.h"
+#include "utils/tuplestore.h"
+
+/* pg_config.c */
+extern const char *pg_config_get_setting(const char *name);
+extern const char *pg_config_get_fingerprint(void);
+extern void pg_config_cache_reset(void);
+extern void pgc_json_append(char *dst, Size *len, const char *str);
+extern void pgc_json_quote(char *dst, Size *len, const char *str);
+extern Tuplestorestate *pgc_init_materialize(FunctionCallInfo fcinfo,
+					 TupleDesc *tupdesc);
+
+/* pg_config_elf.c */
+extern const char *pgc_exec_build_id(char *buf, Size buflen);
+
+/* pg_config_history.c */
+extern int	pgc_history_size;
+extern int	pgc_history_interval;
+extern Size pgc_history_memsize(void);
+extern void pgc_history_shmem_init(void);
+
+/* pg_config_inotify.c */
+extern bool pgc_watch_install;
+extern bool pgc_install_unchanged(uint32 *generation);
+extern void pgc_install_watch(const char *path);
+
+/* pg_config_loadprof.c */
+extern void pgc_loadprof_init(void);
+extern void pgc_loadprof_local_init(void);
+extern void pgc_loadprof_fini(void);
+
+/* pg_config_parse.c */
+extern int	pgc_shell_split(const char *str, char ***tokens);
+extern void pgc_json_parsed(char *dst, Size *len);
+
+/* pg_controldata.c */
+extern const ControlFileData *pgc_controlfile(void);
+extern const char *pgc_dbstate_name(DBState state);
+
+#endif   /* PG_CONFIG_INT_H */
@@ -0,0 +1,374 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_loadprof.c
+ *		Time the loading of shared libraries.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include <sys/stat.h>
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+#ifndef HAVE_GETRUSAGE
+#include "rusagestub.h"
+#endif
+
+#include "dynloader.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/parsenodes.h"
+#include "nodes/pg_list.h"
+#include "portability/instr_time.h"
+#include "tcop/utility.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+
+#include "pg_config_int.h"
+
+/*
+ * There is no hook around the loading of a library, so we time the loads
+ * we can get in front of:
+ *
+ * - shared_preload_libraries: if this module is listed first, its
+ *	 _PG_init opens the rest of the list itself before the postmaster
+ *	 does.  That measures mapping, relocation and constructors; the
+ *	 postmaster's own dlopen then just finds the library already there.
+ *	 The libraries' _PG_init can't be timed this way, since load_file()
+ *	 would unload and reinitialize a library we had loaded completely.
+ *	 Libraries listed before this one are not measured at all.
+ *
+ * - local_preload_libraries: the same trick, in each new backend, if this
+ *	 module is listed first there (which means installing it under
+ *	 $libdir/plugins).  It only works when this module is not also in
+ *	 shared_preload_libraries: a library the postmaster loaded is already
+ *	 there in the backend, so its _PG_init does not run again.
+ *
+ * - LOAD commands, through ProcessUtility_hook, including _PG_init.
+ *
+ * Libraries loaded implicitly on first call of one of their functions are
+ * not seen.  The shared preload timings are taken in the postmaster and
+ * inherited by every backend; the others are per backend.
+ */
+typedef struct LibraryLoad
+{
+	char	   *library;		/* name as given */
+	const char *source;			/* how it was loaded */
+	bool		includes_init;	/* does elapsed cover _PG_init? */
+	double		elapsed;		/* wall clock, in milliseconds */
+	long		minflt;			/* page faults during the load */
+	long		majflt;
+} LibraryLoad;
+
+static LibraryLoad *LibraryLoads = NULL;
+static int	NumLibraryLoads = 0;
+static int	MaxLibraryLoads = 0;
+
+static ProcessUtility_hook_type prev_ProcessUtility = NULL;
+static bool loadprof_hooked = false;
+
+static void install_hook(void);
+static bool preopen_list(const char *liststring, const char *source,
+			 bool local);
+static void preopen_library(const char *filename, const char *loadname,
+				const char *source);
+static void record_load(const char *library, const char *source,
+			bool includes_init, instr_time start,
+			const struct rusage *ru_start);
+static void pgc_ProcessUtility(Node *parsetree, const char *queryString,
+				   ParamListInfo params, bool isTopLevel,
+				   DestReceiver *dest, char *completionTag);
+
+Datum pg_config_library_loads(PG_FUNCTION_ARGS);
+
+/*
+ * Called from _PG_init while shared_preload_libraries is being processed.
+ */
+void
+pgc_loadprof_init(void)
+{
+	install_hook();
+
+	if (shared_preload_libraries_string != NULL)
+		preopen_list(shared_preload_libraries_string,
+					 "shared_preload_libraries", false);
+}
+
+/*
+ * Called from _PG_init when loaded in a backend.  If that load is the
+ * first entry of local_preload_libraries being processed, time the rest.
+ */
+void
+pgc_loadprof_local_init(void)
+{
+	if (!IsUnderPostmaster || local_preload_libraries_string == NULL)
+		return;
+
+	if (preopen_list(local_preload_libraries_string,
+					 "local_preload_libraries", true))
+		install_hook();
+}
+
+/*
+ * Called from _PG_fini.
+ */
+void
+pgc_loadprof_fini(void)
+{
+	if (loadprof_hooked)
+		ProcessUtility_hook = prev_ProcessUtility;
+	loadprof_hooked = false;
+}
+
+static void
+install_hook(void)
+{
+	prev_ProcessUtility = ProcessUtility_hook;
+	ProcessUtility_hook = pgc_ProcessUtility;
+	loadprof_hooked = true;
+}
+
+/*
+ * Preopen the libraries listed after this module in liststring, the value
+ * of the setting called source.  For shared_preload_libraries, those
+ * listed before us are reported as not measured.  For
+ * local_preload_libraries (local is true), we must be the first entry, or
+ * we were not loaded by the list at all; names are resolved under
+ * $libdir/plugins as the backend does.  Returns whether we were found.
+ */
+static bool
+preopen_list(const char *liststring, const char *source, bool local)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	bool		after_us = false;
+
+	/* split the list the same way the server does */
+	rawstring = pstrdup(liststring);
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		/* the server will complain about this shortly */
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	foreach(l, elemlist)
+	{
+		char	   *filename = (char *) lfirst(l);
+		char		loadname[MAXPGPATH];
+
+		canonicalize_path(filename);
+		if (local && first_dir_separator(filename) == NULL)
+			snprintf(loadname, sizeof(loadname), "$libdir/plugins/%s",
+					 filename);
+		else
+			strlcpy(loadname, filename, sizeof(loadname));
+
+		if (after_us)
+		{
+			/* the backend refuses anything outside $libdir/plugins */
+			if (!local || strncmp(loadname, "$libdir/plugins/", 16) == 0)
+				preopen_library(filename, loadname, source);
+		}
+		else
+		{
+			const char *base = last_dir_separator(filename);
+
+			base = base ? base + 1 : filename;
+			if (strcmp(base, "pg_config") == 0 ||
+				strcmp(base, "pg_config" DLSUFFIX) == 0)
+				after_us = true;
+			else if (local)
+				break;
+			else
+				ereport(LOG,
+						(errmsg("load time of library \"%s\" not measured",
+								filename),
+						 errhint("List pg_config first in shared_preload_libraries.")));
+		}
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+
+	return after_us;
+}
+
+/*
+ * dlopen a library from one of the preload lists, given as filename and to
+ * be loaded as loadname, and record how long it took.  The handle is
+ * deliberately kept open, so the server's load of the same file reuses the
+ * mapping.
+ *
+ * Names are resolved the way load_file() does for the common cases: a bare
+ * name or $libdir/name, with or without DLSUFFIX.  Anything we can't find
+ * is left for the server to report.
+ */
+static void
+preopen_library(const char *filename, const char *loadname,
+				const char *source)
+{
+	char		path[MAXPGPATH];
+	const char *name = loadname;
+	struct stat st;
+	instr_time	start;
+	struct rusage ru_start;
+	void	   *handle;
+
+	if (strncmp(name, "$libdir/", 8) == 0)
+		name += 8;
+	else if (first_dir_separator(name) != NULL)
+		name = NULL;
+
+	if (name == NULL)
+		strlcpy(path, loadname, sizeof(path));
+	else
+		snprintf(path, sizeof(path), "%s/%s", pkglib_path, name);
+	if (stat(path, &st) != 0)
+	{
+		Size		len = strlen(path);
+
+		snprintf(path + len, sizeof(path) - len, "%s", DLSUFFIX);
+		if (stat(path, &st) != 0)
+			return;
+	}
+
+	getrusage(RUSAGE_SELF, &ru_start);
+	INSTR_TIME_SET_CURRENT(start);
+
+	handle = pg_dlopen(path);
+	if (handle == NULL)
+		return;
+
+	record_load(filename, source, false, start, &ru_start);
+}
+
+/*
+ * Add an entry for a load that began at start, with resource usage
+ * ru_start, and has just finished.
+ */
+static void
+record_load(const char *library, const char *source, bool includes_init,
+			instr_time start, const struct rusage *ru_start)
+{
+	instr_time	duration;
+	struct rusage ru_end;
+	LibraryLoad *load;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	getrusage(RUSAGE_SELF, &ru_end);
+
+	if (NumLibraryLoads >= MaxLibraryLoads)
+	{
+		MaxLibraryLoads = MaxLibraryLoads ? MaxLibraryLoads * 2 : 16;
+		if (LibraryLoads == NULL)
+			LibraryLoads = MemoryContextAlloc(TopMemoryContext,
+											  MaxLibraryLoads * sizeof(LibraryLoad));
+		else
+			LibraryLoads = repalloc(LibraryLoads,
+									MaxLibraryLoads * sizeof(LibraryLoad));
+	}
+
+	load = &LibraryLoads[NumLibraryLoads++];
+	load->library = MemoryContextStrdup(TopMemoryContext, library);
+	load->source = source;
+	load->includes_init = includes_init;
+	load->elapsed = INSTR_TIME_GET_MILLISEC(duration);
+	load->minflt = ru_end.ru_minflt - ru_start->ru_minflt;
+	load->majflt = ru_end.ru_majflt - ru_start->ru_majflt;
+}
+
+/*
+ * ProcessUtility hook: time LOAD, pass everything through.
+ */
+static void
+pgc_ProcessUtility(Node *parsetree, const char *queryString,
+				   ParamListInfo params, bool isTopLevel,
+				   DestReceiver *dest, char *completionTag)
+{
+	bool		is_load = IsA(parsetree, LoadStmt);
+	instr_time	start;
+	struct rusage ru_start;
+
+	if (is_load)
+	{
+		getrusage(RUSAGE_SELF, &ru_start);
+		INSTR_TIME_SET_CURRENT(start);
+	}
+
+	if (prev_ProcessUtility)
+		prev_ProcessUtility(parsetree, queryString, params,
+							isTopLevel, dest, completionTag);
+	else
+		standard_ProcessUtility(parsetree, queryString, params,
+								isTopLevel, dest, completionTag);
+
+	if (is_load)
+		record_load(((LoadStmt *) parsetree)->filename, "LOAD", true,
+					start, &ru_start);
+}
+
+/*
+ * pg_config_library_loads() returns setof (library text, source text,
+ *											includes_init boolean,
+ *											load_time float8,
+ *											minor_faults bigint,
+ *											major_faults bigint)
+ *
+ * The library loads timed in this backend, in milliseconds, oldest first.
+ */
+PG_FUNCTION_INFO_V1(pg_config_library_loads);
+Datum
+pg_config_library_loads(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	int					i;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	for (i = 0; i < NumLibraryLoads; i++)
+	{
+		Datum		values[6];
+		bool		nulls[6] = {false, false, false, false, false, false};
+
+		values[0] = CStringGetTextDatum(LibraryLoads[i].library);
+		values[1] = CStringGetTextDatum(LibraryLoads[i].source);
+		values[2] = BoolGetDatum(LibraryLoads[i].includes_init);
+		values[3] = Float8GetDatum(LibraryLoads[i].elapsed);
+		values[4] = Int64GetDatum((int64) LibraryLoads[i].minflt);
+		values[5] = Int64GetDatum((int64) LibraryLoads[i].majflt);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
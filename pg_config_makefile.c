@@ -0,0 +1,375 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_makefile.c
+ *		Export the variables set in the installed Makefile.global.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+#include "funcapi.h"
+#include "lib/stringinfo.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+
+#include "pg_config_int.h"
+
+/*
+ * One assignment found in Makefile.global.  op is the assignment operator
+ * ("=", ":=", "?=" or "+="); line is where the assignment starts.  The
+ * same variable can be assigned more than once, for instance in different
+ * ifdef branches, so all assignments are reported in file order.
+ */
+typedef struct MakefileVar
+{
+	char	   *name;
+	char	   *op;
+	char	   *value;
+	int			line;
+} MakefileVar;
+
+/*
+ * The parsed file is cached until its identity or mtime changes.
+ */
+static MemoryContext MakefileContext = NULL;
+static MakefileVar *MakefileVars = NULL;
+static int	NumMakefileVars = 0;
+static struct stat MakefileStat;
+static bool MakefileValid = false;
+static uint32 MakefileGeneration = 0;
+
+static void load_makefile_vars(const char *path);
+static void parse_makefile(const char *buf, size_t len);
+static void skip_line(const char **pp, const char *end, int *lineno);
+
+Datum pg_config_makefile_vars(PG_FUNCTION_ARGS);
+
+/*
+ * pg_config_makefile_vars() returns setof (name text, op text,
+ *											value text, line int)
+ *
+ * The assignments in the Makefile.global installed next to pgxs.mk.
+ */
+PG_FUNCTION_INFO_V1(pg_config_makefile_vars);
+Datum
+pg_config_makefile_vars(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	char				dir[MAXPGPATH];
+	char				path[MAXPGPATH];
+	char			   *sep;
+	int					i;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	/* PGXS is .../pgxs/src/makefiles/pgxs.mk; we want .../pgxs/src/ */
+	strlcpy(dir, pg_config_get_setting("PGXS"), sizeof(dir));
+	if ((sep = strrchr(dir, '/')) != NULL)
+		*sep = '\0';
+	if ((sep = strrchr(dir, '/')) != NULL)
+		*sep = '\0';
+	snprintf(path, sizeof(path), "%s/Makefile.global", dir);
+
+	if (!pgc_install_unchanged(&MakefileGeneration) || !MakefileValid)
+	{
+		pgc_install_watch(dir);
+		load_makefile_vars(path);
+	}
+
+	for (i = 0; i < NumMakefileVars; i++)
+	{
+		Datum		values[4];
+		bool		nulls[4] = {false, false, false, false};
+
+		values[0] = CStringGetTextDatum(MakefileVars[i].name);
+		values[1] = CStringGetTextDatum(MakefileVars[i].op);
+		values[2] = CStringGetTextDatum(MakefileVars[i].value);
+		values[3] = Int32GetDatum(MakefileVars[i].line);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Make sure MakefileVars[] reflects the current contents of path.
+ */
+static void
+load_makefile_vars(const char *path)
+{
+	MemoryContext	oldcontext;
+	struct stat		st;
+	int				fd;
+	char		   *buf;
+
+	fd = BasicOpenFile((char *) path, O_RDONLY | PG_BINARY, 0);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+	}
+
+	if (MakefileValid &&
+		st.st_dev == MakefileStat.st_dev &&
+		st.st_ino == MakefileStat.st_ino &&
+		st.st_size == MakefileStat.st_size &&
+		st.st_mtime == MakefileStat.st_mtime)
+	{
+		close(fd);
+		return;
+	}
+
+	MakefileValid = false;
+	if (MakefileContext == NULL)
+		MakefileContext = AllocSetContextCreate(TopMemoryContext,
+												"pg_config makefile cache",
+												ALLOCSET_DEFAULT_MINSIZE,
+												ALLOCSET_DEFAULT_INITSIZE,
+												ALLOCSET_DEFAULT_MAXSIZE);
+	else
+		MemoryContextReset(MakefileContext);
+	MakefileVars = NULL;
+	NumMakefileVars = 0;
+
+	oldcontext = MemoryContextSwitchTo(MakefileContext);
+
+	if (st.st_size > 0)
+	{
+#ifndef WIN32
+		buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (buf == MAP_FAILED)
+		{
+			close(fd);
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not map file \"%s\": %m", path)));
+		}
+		close(fd);
+
+		/* an error while parsing must not leave the mapping behind */
+		PG_TRY();
+		{
+			parse_makefile(buf, st.st_size);
+		}
+		PG_CATCH();
+		{
+			munmap(buf, st.st_size);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+		munmap(buf, st.st_size);
+#else
+		buf = palloc(st.st_size);
+		if (read(fd, buf, st.st_size) != st.st_size)
+		{
+			close(fd);
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", path)));
+		}
+		close(fd);
+		parse_makefile(buf, st.st_size);
+		pfree(buf);
+#endif
+	}
+	else
+		close(fd);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	MakefileStat = st;
+	MakefileValid = true;
+}
+
+/*
+ * Advance *pp past the end of the current line, and past any lines joined
+ * to it by a trailing backslash.
+ */
+static void
+skip_line(const char **pp, const char *end, int *lineno)
+{
+	const char *p = *pp;
+
+	while (p < end)
+	{
+		if (*p == '\\' && p + 1 < end && p[1] == '\n')
+		{
+			p += 2;
+			(*lineno)++;
+			continue;
+		}
+		if (*p++ == '\n')
+		{
+			(*lineno)++;
+			break;
+		}
+	}
+	*pp = p;
+}
+
+/*
+ * Scan a makefile in one pass, collecting "NAME op value" assignments into
+ * MakefileVars[].  Recipe lines, comments, conditionals, includes and
+ * define ... endef blocks are skipped.  Continued lines are joined with a
+ * single space, as make does.
+ */
+static void
+parse_makefile(const char *buf, size_t len)
+{
+	const char *p = buf;
+	const char *end = buf + len;
+	int			lineno = 1;
+	int			maxvars = 64;
+	bool		indefine = false;
+	StringInfoData value;
+
+	MakefileVars = palloc(maxvars * sizeof(MakefileVar));
+	initStringInfo(&value);
+
+	while (p < end)
+	{
+		const char *name;
+		const char *op;
+		int			startline = lineno;
+		int			namelen;
+		int			oplen;
+
+		/* recipe lines start with a tab */
+		if (*p == '\t' && !indefine)
+		{
+			skip_line(&p, end, &lineno);
+			continue;
+		}
+
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+
+		if (indefine)
+		{
+			if (end - p >= 5 && strncmp(p, "endef", 5) == 0)
+				indefine = false;
+			skip_line(&p, end, &lineno);
+			continue;
+		}
+
+		/* "override" and "export" may precede an assignment */
+		if (end - p > 9 && strncmp(p, "override ", 9) == 0)
+			p += 9;
+		else if (end - p > 7 && strncmp(p, "export ", 7) == 0)
+			p += 7;
+
+		name = p;
+		while (p < end && (isalnum((unsigned char) *p) || *p == '_' ||
+						   *p == '.' || *p == '-'))
+			p++;
+		namelen = p - name;
+
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+
+		op = p;
+		if (p < end && *p == '=')
+			oplen = 1;
+		else if (end - p >= 2 && p[1] == '=' &&
+				 (*p == ':' || *p == '?' || *p == '+'))
+			oplen = 2;
+		else
+			oplen = 0;
+
+		if (namelen == 0 || oplen == 0)
+		{
+			/* not an assignment: comment, rule, conditional or include */
+			if (namelen == 6 && strncmp(name, "define", 6) == 0)
+				indefine = true;
+			skip_line(&p, end, &lineno);
+			continue;
+		}
+		p += oplen;
+
+		/* collect the value, joining continuation lines */
+		resetStringInfo(&value);
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+		while (p < end && *p != '\n')
+		{
+			if (*p == '\\' && p + 1 < end && p[1] == '\n')
+			{
+				p += 2;
+				lineno++;
+				while (p < end && (*p == ' ' || *p == '\t'))
+					p++;
+				while (value.len > 0 && value.data[value.len - 1] == ' ')
+					value.data[--value.len] = '\0';
+				appendStringInfoChar(&value, ' ');
+			}
+			else if (*p == '\\' && p + 1 < end && p[1] == '#')
+			{
+				appendStringInfoChar(&value, '#');
+				p += 2;
+			}
+			else if (*p == '#')
+				break;			/* the rest of the line is a comment */
+			else
+				appendStringInfoChar(&value, *p++);
+		}
+		skip_line(&p, end, &lineno);
+
+		while (value.len > 0 &&
+			   (value.data[value.len - 1] == ' ' ||
+				value.data[value.len - 1] == '\t'))
+			value.data[--value.len] = '\0';
+
+		if (NumMakefileVars >= maxvars)
+		{
+			maxvars *= 2;
+			MakefileVars = repalloc(MakefileVars,
+									maxvars * sizeof(MakefileVar));
+		}
+		MakefileVars[NumMakefileVars].name = pnstrdup(name, namelen);
+		MakefileVars[NumMakefileVars].op = pnstrdup(op, oplen);
+		MakefileVars[NumMakefileVars].value = pstrdup(value.data);
+		MakefileVars[NumMakefileVars].line = startline;
+		NumMakefileVars++;
+	}
+
+	pfree(value.data);
+}
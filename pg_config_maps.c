@@ -0,0 +1,322 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_maps.c
+ *		List the shared objects mapped into the current backend.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "funcapi.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+
+#include "pg_config_int.h"
+
+#define PROC_MAPS		"/proc/self/maps"
+#define DELETED_SUFFIX	" (deleted)"
+
+/*
+ * One shared object.  A library is normally mapped several times, once
+ * per segment (text, read-only data, writable data), so the mappings are
+ * folded together by device and inode.  path points into the buffer the
+ * maps file was read into.
+ */
+typedef struct MappedObject
+{
+	const char *path;
+	int			pathlen;
+	unsigned long dev_major;
+	unsigned long dev_minor;
+	unsigned long inode;
+	unsigned long start;		/* lowest mapped address */
+	unsigned long size;			/* total bytes mapped */
+	unsigned long text_size;	/* bytes mapped executable */
+	bool		deleted;
+} MappedObject;
+
+static char *read_proc_maps(Size *len);
+static bool is_shared_object(const char *path, int pathlen);
+
+Datum pg_config_loaded_libraries(PG_FUNCTION_ARGS);
+
+/*
+ * pg_config_loaded_libraries() returns setof (path text, address text,
+ *											  size bigint, text_size bigint,
+ *											  in_pkglibdir boolean,
+ *											  deleted boolean)
+ *
+ * The shared libraries this backend has mapped, according to
+ * /proc/self/maps.  deleted means the file on disk has been removed or
+ * replaced since it was loaded.
+ */
+PG_FUNCTION_INFO_V1(pg_config_loaded_libraries);
+Datum
+pg_config_loaded_libraries(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	char			   *buf;
+	Size				len;
+	const char		   *p;
+	const char		   *end;
+	MappedObject	   *objects;
+	int					nobjects = 0;
+	int					maxobjects = 64;
+	char				pkglibdir[MAXPGPATH];
+	char			   *resolved;
+	Size				pkglibdirlen;
+	int					i;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	/* the kernel reports resolved paths, so compare against one */
+	resolved = realpath(pg_config_get_setting("PKGLIBDIR"), NULL);
+	if (resolved != NULL)
+	{
+		snprintf(pkglibdir, sizeof(pkglibdir), "%s/", resolved);
+		free(resolved);
+	}
+	else
+		snprintf(pkglibdir, sizeof(pkglibdir), "%s/",
+				 pg_config_get_setting("PKGLIBDIR"));
+	pkglibdirlen = strlen(pkglibdir);
+
+	buf = read_proc_maps(&len);
+	objects = palloc(maxobjects * sizeof(MappedObject));
+
+	/*
+	 * Each line is "start-end perms offset major:minor inode   path".  The
+	 * fields are parsed in place; nothing is copied until output.
+	 */
+	p = buf;
+	end = buf + len;
+	while (p < end)
+	{
+		const char *eol = memchr(p, '\n', end - p);
+		const char *perms;
+		const char *path;
+		unsigned long start;
+		unsigned long stop;
+		unsigned long dev_major;
+		unsigned long dev_minor;
+		unsigned long inode;
+		int			pathlen;
+		bool		deleted = false;
+		char	   *q;
+		MappedObject *obj;
+
+		if (eol == NULL)
+			eol = end;
+
+		start = strtoul(p, &q, 16);
+		if (*q != '-')
+			goto next;
+		stop = strtoul(q + 1, &q, 16);
+		while (*q == ' ')
+			q++;
+		perms = q;
+		while (q < eol && *q != ' ')
+			q++;
+		(void) strtoul(q, &q, 16);			/* offset */
+		dev_major = strtoul(q, &q, 16);
+		if (*q != ':')
+			goto next;
+		dev_minor = strtoul(q + 1, &q, 16);
+		inode = strtoul(q, &q, 10);
+		if (q > eol)
+			goto next;			/* malformed line; strtoul ran past it */
+		while (q < eol && *q == ' ')
+			q++;
+		path = q;
+		pathlen = eol - path;
+
+		/* anonymous, [heap], [stack] and the like have no inode */
+		if (inode == 0 || pathlen == 0 || path[0] != '/')
+			goto next;
+		if (pathlen > sizeof(DELETED_SUFFIX) - 1 &&
+			memcmp(eol - (sizeof(DELETED_SUFFIX) - 1), DELETED_SUFFIX,
+				   sizeof(DELETED_SUFFIX) - 1) == 0)
+		{
+			pathlen -= sizeof(DELETED_SUFFIX) - 1;
+			deleted = true;
+		}
+		if (!is_shared_object(path, pathlen))
+			goto next;
+
+		/* there are rarely more than a few dozen, so search linearly */
+		obj = NULL;
+		for (i = 0; i < nobjects; i++)
+		{
+			if (objects[i].inode == inode &&
+				objects[i].dev_major == dev_major &&
+				objects[i].dev_minor == dev_minor &&
+				objects[i].pathlen == pathlen &&
+				memcmp(objects[i].path, path, pathlen) == 0)
+			{
+				obj = &objects[i];
+				break;
+			}
+		}
+		if (obj == NULL)
+		{
+			if (nobjects >= maxobjects)
+			{
+				maxobjects *= 2;
+				objects = repalloc(objects, maxobjects * sizeof(MappedObject));
+			}
+			obj = &objects[nobjects++];
+			obj->path = path;
+			obj->pathlen = pathlen;
+			obj->dev_major = dev_major;
+			obj->dev_minor = dev_minor;
+			obj->inode = inode;
+			obj->start = start;
+			obj->size = 0;
+			obj->text_size = 0;
+			obj->deleted = false;
+		}
+		if (start < obj->start)
+			obj->start = start;
+		obj->size += stop - start;
+		if (perms[2] == 'x')
+			obj->text_size += stop - start;
+		obj->deleted |= deleted;
+
+next:
+		p = eol + 1;
+	}
+
+	for (i = 0; i < nobjects; i++)
+	{
+		MappedObject *obj = &objects[i];
+		Datum		values[6];
+		bool		nulls[6] = {false, false, false, false, false, false};
+		char		addr[32];
+
+		snprintf(addr, sizeof(addr), "0x%lx", obj->start);
+
+		values[0] = PointerGetDatum(cstring_to_text_with_len(obj->path,
+															 obj->pathlen));
+		values[1] = CStringGetTextDatum(addr);
+		values[2] = Int64GetDatum((int64) obj->size);
+		values[3] = Int64GetDatum((int64) obj->text_size);
+		values[4] = BoolGetDatum(obj->pathlen > pkglibdirlen &&
+								 strncmp(obj->path, pkglibdir,
+										 pkglibdirlen) == 0);
+		values[5] = BoolGetDatum(obj->deleted);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	pfree(objects);
+	pfree(buf);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Read all of /proc/self/maps into a palloc'd, NUL-terminated buffer.
+ * Files in /proc have no size and can't be mapped, so read until EOF.
+ */
+static char *
+read_proc_maps(Size *len)
+{
+	int			fd;
+	char	   *buf;
+	Size		bufsize = 16384;
+	Size		nread = 0;
+
+	fd = BasicOpenFile(PROC_MAPS, O_RDONLY, 0);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("pg_config_loaded_libraries() is not supported on this platform"),
+					 errdetail("File \"%s\" does not exist.", PROC_MAPS)));
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", PROC_MAPS)));
+	}
+
+	buf = palloc(bufsize);
+	for (;;)
+	{
+		ssize_t		rc;
+
+		/* keep a byte for the terminator */
+		if (nread == bufsize - 1)
+		{
+			bufsize *= 2;
+			buf = repalloc(buf, bufsize);
+		}
+		rc = read(fd, buf + nread, bufsize - nread - 1);
+		if (rc < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			close(fd);
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", PROC_MAPS)));
+		}
+		if (rc == 0)
+			break;
+		nread += rc;
+	}
+	close(fd);
+
+	buf[nread] = '\0';
+	*len = nread;
+	return buf;
+}
+
+/*
+ * Does the file name look like a shared library, as in "plpgsql.so" or
+ * "libc.so.6"?
+ */
+static bool
+is_shared_object(const char *path, int pathlen)
+{
+	const char *base = path + pathlen;
+	const char *p;
+
+	while (base > path && base[-1] != '/')
+		base--;
+
+	for (p = base; p + 3 <= path + pathlen; p++)
+	{
+		if (memcmp(p, ".so", 3) == 0 &&
+			(p + 3 == path + pathlen || p[3] == '.'))
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,828 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_config_parse.c
+ *		Break the recorded configure and compiler settings into pieces.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include <ctype.h>
+
+#include "funcapi.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+
+#include "pg_config_int.h"
+
+/*
+ * One configure switch, split at the first '='.  value is NULL for
+ * switches without an argument, such as --enable-debug.
+ */
+typedef struct ConfigureOption
+{
+	char	   *option;
+	char	   *value;
+} ConfigureOption;
+
+/*
+ * One word of a compiler or linker flag variable, classified by kind.
+ * flag is the switch itself, such as "-O" or "-march"; argument is what
+ * follows it, or NULL if the switch takes none.
+ */
+typedef struct CompilerFlag
+{
+	const char *variable;
+	const char *kind;
+	char	   *flag;
+	char	   *argument;
+} CompilerFlag;
+
+/*
+ * One option of a setting being compared by pg_config_diff().  Options
+ * with the same key are alternatives for the same thing, such as -O2 and
+ * -O3; value is NULL for options that are either present or absent.
+ */
+typedef struct DiffOption
+{
+	const char *key;
+	const char *value;
+} DiffOption;
+
+/*
+ * The pg_config rows pg_config_diff() compares option by option.  This
+ * list is fixed rather than taken from FlagVariables[], so that the result
+ * does not depend on which settings this build recorded.
+ */
+static const char *const DiffVariables[] =
+{
+	"CONFIGURE", "CC", "CPPFLAGS", "CFLAGS", "CFLAGS_SL",
+	"LDFLAGS", "LDFLAGS_SL", "LIBS"
+};
+
+/*
+ * The flag variables recorded by the Makefile, in pg_config order.
+ */
+static const struct
+{
+	const char *variable;
+	const char *value;
+}	FlagVariables[] =
+{
+#ifdef VAL_CPPFLAGS
+	{"CPPFLAGS", VAL_CPPFLAGS},
+#endif
+#ifdef VAL_CFLAGS
+	{"CFLAGS", VAL_CFLAGS},
+#endif
+#ifdef VAL_CFLAGS_SL
+	{"CFLAGS_SL", VAL_CFLAGS_SL},
+#endif
+#ifdef VAL_LDFLAGS
+	{"LDFLAGS", VAL_LDFLAGS},
+#endif
+#ifdef VAL_LDFLAGS_SL
+	{"LDFLAGS_SL", VAL_LDFLAGS_SL},
+#endif
+#ifdef VAL_LIBS
+	{"LIBS", VAL_LIBS},
+#endif
+	{NULL, NULL}
+};
+
+/*
+ * The configure line never changes for the life of the backend, so it is
+ * tokenized on first use and kept in ParseCacheContext.
+ */
+static MemoryContext ParseCacheContext = NULL;
+static ConfigureOption *ConfigureOptions = NULL;
+static int	NumConfigureOptions = -1;	/* -1 until parsed */
+static CompilerFlag *CompilerFlags = NULL;
+static int	NumCompilerFlags = -1;	/* -1 until parsed */
+
+static MemoryContext get_parse_context(void);
+static void parse_configure_options(void);
+static void parse_compiler_flags(void);
+static int	classify_flag(CompilerFlag *cflag, char **words, int nwords);
+static int	split_diff_options(const char *name, const char *setting,
+							   DiffOption **options);
+static char *join_flag(const char *flag, const char *argument);
+static int	diff_option_cmp(const void *a, const void *b);
+static int	diff_value_cmp(const char *a, const char *b);
+static void diff_put(Tuplestorestate *tupstore, TupleDesc tupdesc,
+					 const char *item, const char *change,
+					 const char *oldvalue, const char *newvalue);
+
+Datum pg_config_configure_options(PG_FUNCTION_ARGS);
+Datum pg_config_flags(PG_FUNCTION_ARGS);
+Datum pg_config_diff(PG_FUNCTION_ARGS);
+
+/*
+ * pg_config_configure_options() returns setof (option text, value text)
+ *
+ * One row per switch given to configure, in the original order.
+ */
+PG_FUNCTION_INFO_V1(pg_config_configure_options);
+Datum
+pg_config_configure_options(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	int					i;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	if (NumConfigureOptions < 0)
+		parse_configure_options();
+
+	for (i = 0; i < NumConfigureOptions; i++)
+	{
+		Datum		values[2];
+		bool		nulls[2] = {false, false};
+
+		values[0] = CStringGetTextDatum(ConfigureOptions[i].option);
+		if (ConfigureOptions[i].value)
+			values[1] = CStringGetTextDatum(ConfigureOptions[i].value);
+		else
+			nulls[1] = true;
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * pg_config_flags() returns setof (variable text, kind text, flag text,
+ *									argument text)
+ *
+ * One row per word of the compiler and linker flag variables.  kind is one
+ * of optimization, arch, define, include, library, linker, debug, warning,
+ * codegen or other.
+ */
+PG_FUNCTION_INFO_V1(pg_config_flags);
+Datum
+pg_config_flags(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	int					i;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	if (NumCompilerFlags < 0)
+		parse_compiler_flags();
+
+	for (i = 0; i < NumCompilerFlags; i++)
+	{
+		Datum		values[4];
+		bool		nulls[4] = {false, false, false, false};
+
+		values[0] = CStringGetTextDatum(CompilerFlags[i].variable);
+		values[1] = CStringGetTextDatum(CompilerFlags[i].kind);
+		values[2] = CStringGetTextDatum(CompilerFlags[i].flag);
+		if (CompilerFlags[i].argument)
+			values[3] = CStringGetTextDatum(CompilerFlags[i].argument);
+		else
+			nulls[3] = true;
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * pg_config_diff(name text, old text, new text)
+ *		returns setof (item text, change text, old_value text, new_value text)
+ *
+ * Compare two settings of the pg_config row called name, typically taken
+ * from different servers.  CONFIGURE, CC and the flag variables are compared
+ * option by option, so reordering alone is not a difference; change is
+ * added, removed or changed, the latter when an option such as -O or
+ * --with-libraries has a different value.  Any other setting is reported
+ * as a single changed item when the strings differ.  A NULL setting is
+ * treated as empty, so that rows missing on one side of a full join show
+ * up as added or removed.
+ */
+PG_FUNCTION_INFO_V1(pg_config_diff);
+Datum
+pg_config_diff(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	char			   *name;
+	char			   *oldsetting;
+	char			   *newsetting;
+	DiffOption		   *oldopts;
+	DiffOption		   *newopts;
+	int					nold;
+	int					nnew;
+	int					i,
+						j,
+						k,
+						l;
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	if (PG_ARGISNULL(0))
+	{
+		tuplestore_donestoring(tupstore);
+		return (Datum) 0;
+	}
+	name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	oldsetting = PG_ARGISNULL(1) ? "" : text_to_cstring(PG_GETARG_TEXT_PP(1));
+	newsetting = PG_ARGISNULL(2) ? "" : text_to_cstring(PG_GETARG_TEXT_PP(2));
+
+	nold = split_diff_options(name, oldsetting, &oldopts);
+	nnew = split_diff_options(name, newsetting, &newopts);
+
+	if (nold < 0)
+	{
+		/* not a tokenized setting: compare the strings */
+		if (strcmp(oldsetting, newsetting) != 0)
+			diff_put(tupstore, tupdesc, name,
+					 PG_ARGISNULL(1) ? "added" :
+					 PG_ARGISNULL(2) ? "removed" : "changed",
+					 PG_ARGISNULL(1) ? NULL : oldsetting,
+					 PG_ARGISNULL(2) ? NULL : newsetting);
+		tuplestore_donestoring(tupstore);
+		return (Datum) 0;
+	}
+
+	qsort(oldopts, nold, sizeof(DiffOption), diff_option_cmp);
+	qsort(newopts, nnew, sizeof(DiffOption), diff_option_cmp);
+
+	/*
+	 * First drop the options present on both sides, compacting what is left
+	 * to the front of each array; both stay sorted.
+	 */
+	i = j = k = l = 0;
+	while (i < nold || j < nnew)
+	{
+		int			cmp;
+
+		if (i >= nold)
+			cmp = 1;
+		else if (j >= nnew)
+			cmp = -1;
+		else
+			cmp = diff_option_cmp(&oldopts[i], &newopts[j]);
+
+		if (cmp == 0)
+		{
+			i++;
+			j++;
+		}
+		else if (cmp < 0)
+			oldopts[k++] = oldopts[i++];
+		else
+			newopts[l++] = newopts[j++];
+	}
+	nold = k;
+	nnew = l;
+
+	/* then pair up what remains by key */
+	i = j = 0;
+	while (i < nold || j < nnew)
+	{
+		int			cmp;
+
+		if (i >= nold)
+			cmp = 1;
+		else if (j >= nnew)
+			cmp = -1;
+		else
+			cmp = strcmp(oldopts[i].key, newopts[j].key);
+
+		if (cmp == 0)
+		{
+			diff_put(tupstore, tupdesc, oldopts[i].key, "changed",
+					 oldopts[i].value, newopts[j].value);
+			i++;
+			j++;
+		}
+		else if (cmp < 0)
+		{
+			diff_put(tupstore, tupdesc, oldopts[i].key, "removed",
+					 oldopts[i].value, NULL);
+			i++;
+		}
+		else
+		{
+			diff_put(tupstore, tupdesc, newopts[j].key, "added",
+					 NULL, newopts[j].value);
+			j++;
+		}
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Split str into words the way a POSIX shell would.  Words are separated
+ * by unquoted whitespace.  Single quotes preserve everything up to the
+ * next single quote; double quotes preserve everything except backslash
+ * escapes of $ ` " \ and newline; an unquoted backslash quotes the next
+ * character.  The words are palloc'd in the current memory context and
+ * returned in *tokens; the result is the number of words.
+ */
+int
+pgc_shell_split(const char *str, char ***tokens)
+{
+	const char *p = str;
+	size_t		len = strlen(str);
+	char	   *buf;
+	char	  **result;
+	int			ntokens = 0;
+
+	/* every word but the last needs at least one separator */
+	result = palloc((len / 2 + 1) * sizeof(char *));
+	buf = palloc(len + 1);
+
+	for (;;)
+	{
+		char	   *out = buf;
+
+		while (isspace((unsigned char) *p))
+			p++;
+		if (*p == '\0')
+			break;
+
+		while (*p && !isspace((unsigned char) *p))
+		{
+			if (*p == '\'')
+			{
+				for (p++; *p && *p != '\''; p++)
+					*out++ = *p;
+				if (*p)
+					p++;
+			}
+			else if (*p == '"')
+			{
+				for (p++; *p && *p != '"'; p++)
+				{
+					if (*p == '\\' && p[1] && strchr("$`\"\\\n", p[1]))
+						p++;
+					*out++ = *p;
+				}
+				if (*p)
+					p++;
+			}
+			else if (*p == '\\' && p[1] == '\n')
+				p += 2;			/* line continuation */
+			else if (*p == '\\' && p[1])
+			{
+				*out++ = p[1];
+				p += 2;
+			}
+			else
+				*out++ = *p++;
+		}
+
+		result[ntokens++] = pnstrdup(buf, out - buf);
+	}
+
+	pfree(buf);
+	*tokens = result;
+
+	return ntokens;
+}
+
+/*
+ * Write the "configure_options" and "flags" members of the pg_config_json()
+ * document at dst + *len, advancing *len; if dst is NULL, only measure.
+ * Each array element is an object with the columns of the corresponding
+ * function.
+ */
+void
+pgc_json_parsed(char *dst, Size *len)
+{
+	int			i;
+
+	if (NumConfigureOptions < 0)
+		parse_configure_options();
+	if (NumCompilerFlags < 0)
+		parse_compiler_flags();
+
+	pgc_json_append(dst, len, "\"configure_options\":[");
+	for (i = 0; i < NumConfigureOptions; i++)
+	{
+		if (i > 0)
+			pgc_json_append(dst, len, ",");
+		pgc_json_append(dst, len, "{\"option\":");
+		pgc_json_quote(dst, len, ConfigureOptions[i].option);
+		pgc_json_append(dst, len, ",\"value\":");
+		pgc_json_quote(dst, len, ConfigureOptions[i].value);
+		pgc_json_append(dst, len, "}");
+	}
+
+	pgc_json_append(dst, len, "],\"flags\":[");
+	for (i = 0; i < NumCompilerFlags; i++)
+	{
+		if (i > 0)
+			pgc_json_append(dst, len, ",");
+		pgc_json_append(dst, len, "{\"variable\":");
+		pgc_json_quote(dst, len, CompilerFlags[i].variable);
+		pgc_json_append(dst, len, ",\"kind\":");
+		pgc_json_quote(dst, len, CompilerFlags[i].kind);
+		pgc_json_append(dst, len, ",\"flag\":");
+		pgc_json_quote(dst, len, CompilerFlags[i].flag);
+		pgc_json_append(dst, len, ",\"argument\":");
+		pgc_json_quote(dst, len, CompilerFlags[i].argument);
+		pgc_json_append(dst, len, "}");
+	}
+	pgc_json_append(dst, len, "]");
+}
+
+/*
+ * Return the memory context holding the parsed settings, creating it if
+ * needed.
+ */
+static MemoryContext
+get_parse_context(void)
+{
+	if (ParseCacheContext == NULL)
+		ParseCacheContext = AllocSetContextCreate(TopMemoryContext,
+												  "pg_config parse cache",
+												  ALLOCSET_SMALL_MINSIZE,
+												  ALLOCSET_SMALL_INITSIZE,
+												  ALLOCSET_SMALL_MAXSIZE);
+	return ParseCacheContext;
+}
+
+/*
+ * Tokenize the configure line into ConfigureOptions[].
+ */
+static void
+parse_configure_options(void)
+{
+	MemoryContext	oldcontext;
+	char		  **words = NULL;
+	int				nwords = 0;
+	int				i;
+
+	oldcontext = MemoryContextSwitchTo(get_parse_context());
+
+#ifdef VAL_CONFIGURE
+	nwords = pgc_shell_split(VAL_CONFIGURE, &words);
+#endif
+
+	ConfigureOptions = palloc((nwords + 1) * sizeof(ConfigureOption));
+	for (i = 0; i < nwords; i++)
+	{
+		char	   *eq = strchr(words[i], '=');
+
+		ConfigureOptions[i].option = words[i];
+		ConfigureOptions[i].value = NULL;
+		if (eq)
+		{
+			*eq = '\0';
+			ConfigureOptions[i].value = eq + 1;
+		}
+	}
+	NumConfigureOptions = nwords;
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Tokenize the flag variables into CompilerFlags[].
+ */
+static void
+parse_compiler_flags(void)
+{
+	MemoryContext	oldcontext;
+	int				maxflags = 0;
+	int				v;
+
+	oldcontext = MemoryContextSwitchTo(get_parse_context());
+
+	for (v = 0; FlagVariables[v].variable; v++)
+		maxflags += strlen(FlagVariables[v].value) / 2 + 1;
+	CompilerFlags = palloc(maxflags * sizeof(CompilerFlag));
+	NumCompilerFlags = 0;
+
+	for (v = 0; FlagVariables[v].variable; v++)
+	{
+		char	  **words;
+		int			nwords;
+		int			i;
+
+		nwords = pgc_shell_split(FlagVariables[v].value, &words);
+		for (i = 0; i < nwords;)
+		{
+			CompilerFlag *cflag = &CompilerFlags[NumCompilerFlags++];
+
+			cflag->variable = FlagVariables[v].variable;
+			i += classify_flag(cflag, words + i, nwords - i);
+		}
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Fill in cflag from words[0], which is followed by nwords - 1 more words.
+ * Switches such as "-I dir" or "-Xlinker opt" take their argument from the
+ * next word.  Returns the number of words consumed.
+ */
+static int
+classify_flag(CompilerFlag *cflag, char **words, int nwords)
+{
+	char	   *word = words[0];
+	char	   *eq;
+
+	cflag->flag = word;
+	cflag->argument = NULL;
+
+	if (word[0] != '-')
+	{
+		cflag->kind = "other";
+		return 1;
+	}
+
+	switch (word[1])
+	{
+		case 'O':
+			cflag->kind = "optimization";
+			break;
+		case 'D':
+		case 'U':
+			cflag->kind = "define";
+			break;
+		case 'I':
+			cflag->kind = "include";
+			break;
+		case 'L':
+		case 'l':
+			cflag->kind = "library";
+			break;
+		case 'g':
+			cflag->kind = "debug";
+			break;
+		case 'm':
+			/* -march=x, -mtune=x, -mcpu=x, or a bare target switch */
+			cflag->kind = "arch";
+			eq = strchr(word, '=');
+			if (eq)
+			{
+				cflag->flag = pnstrdup(word, eq - word);
+				cflag->argument = eq + 1;
+			}
+			return 1;
+		case 'W':
+			if (strncmp(word, "-Wl,", 4) == 0)
+			{
+				cflag->kind = "linker";
+				cflag->flag = "-Wl";
+				cflag->argument = word + 4;
+			}
+			else
+				cflag->kind = "warning";
+			return 1;
+		case 'f':
+			cflag->kind = "codegen";
+			return 1;
+		default:
+			if (strcmp(word, "-Xlinker") == 0)
+			{
+				cflag->kind = "linker";
+				if (nwords > 1)
+				{
+					cflag->argument = words[1];
+					return 2;
+				}
+			}
+			else if (strcmp(word, "-isystem") == 0 ||
+					 strcmp(word, "-idirafter") == 0)
+			{
+				cflag->kind = "include";
+				if (nwords > 1)
+				{
+					cflag->argument = words[1];
+					return 2;
+				}
+			}
+			else if (strcmp(word, "-shared") == 0 ||
+					 strcmp(word, "-static") == 0 ||
+					 strcmp(word, "-rdynamic") == 0 ||
+					 strcmp(word, "-pthread") == 0)
+				cflag->kind = "linker";
+			else
+				cflag->kind = "other";
+			return 1;
+	}
+
+	/* single-letter switch, with its argument attached or in the next word */
+	cflag->flag = pnstrdup(word, 2);
+	if (word[2] != '\0')
+		cflag->argument = word + 2;
+	else if (nwords > 1 && word[1] != 'O' && word[1] != 'g')
+	{
+		cflag->argument = words[1];
+		return 2;
+	}
+
+	return 1;
+}
+
+/*
+ * Break setting, the value of the pg_config row called name, into options
+ * for pg_config_diff().  Configure switches are keyed by the part before
+ * the first '='.  Compiler flags are split with classify_flag(); those
+ * that select one of several alternatives (-O, -g, -march=, -DNAME=,
+ * -std= and the like) are keyed by the switch so that a different value
+ * shows up as a change, and the rest are keyed by the whole option.
+ * Returns -1 if name is not a tokenized setting.
+ */
+static int
+split_diff_options(const char *name, const char *setting,
+				   DiffOption **options)
+{
+	DiffOption *opts;
+	char	  **words;
+	int			nwords;
+	int			nopts = 0;
+	int			i;
+	int			v;
+
+	if (strcmp(name, "CONFIGURE") == 0)
+	{
+		nwords = pgc_shell_split(setting, &words);
+		opts = palloc((nwords + 1) * sizeof(DiffOption));
+		for (i = 0; i < nwords; i++)
+		{
+			char	   *eq = strchr(words[i], '=');
+
+			opts[i].key = words[i];
+			opts[i].value = NULL;
+			if (eq)
+			{
+				*eq = '\0';
+				opts[i].value = eq + 1;
+			}
+		}
+		*options = opts;
+		return nwords;
+	}
+
+	for (v = 0; v < lengthof(DiffVariables); v++)
+		if (strcmp(name, DiffVariables[v]) == 0)
+			break;
+	if (v == lengthof(DiffVariables))
+		return -1;
+
+	nwords = pgc_shell_split(setting, &words);
+	opts = palloc((nwords + 1) * sizeof(DiffOption));
+	for (i = 0; i < nwords;)
+	{
+		CompilerFlag cflag;
+		DiffOption *opt = &opts[nopts++];
+		char	   *eq;
+
+		i += classify_flag(&cflag, words + i, nwords - i);
+
+		if (strcmp(cflag.kind, "optimization") == 0 ||
+			strcmp(cflag.kind, "debug") == 0 ||
+			strcmp(cflag.kind, "arch") == 0)
+		{
+			opt->key = cflag.flag;
+			opt->value = cflag.argument;
+		}
+		else if (strcmp(cflag.kind, "define") == 0 && cflag.argument)
+		{
+			/* -DNAME=value is keyed by -DNAME */
+			char	   *arg = pstrdup(cflag.argument);
+
+			opt->value = NULL;
+			if ((eq = strchr(arg, '=')) != NULL)
+			{
+				*eq = '\0';
+				opt->value = eq + 1;
+			}
+			opt->key = join_flag(cflag.flag, arg);
+		}
+		else if ((strcmp(cflag.kind, "codegen") == 0 ||
+				  strcmp(cflag.kind, "other") == 0) &&
+				 cflag.flag[0] == '-' &&
+				 (eq = strchr(cflag.flag, '=')) != NULL)
+		{
+			/* -std=c99, -fvisibility=hidden and the like */
+			opt->key = pnstrdup(cflag.flag, eq - cflag.flag);
+			opt->value = eq + 1;
+		}
+		else
+		{
+			opt->key = cflag.argument ?
+				join_flag(cflag.flag, cflag.argument) : cflag.flag;
+			opt->value = NULL;
+		}
+	}
+
+	*options = opts;
+	return nopts;
+}
+
+/*
+ * Put a switch and its argument back together the way they are usually
+ * written: "-I/usr/include", "-Wl,--as-needed", "-Xlinker --as-needed".
+ */
+static char *
+join_flag(const char *flag, const char *argument)
+{
+	const char *sep = "";
+	size_t		len;
+	char	   *result;
+
+	if (strcmp(flag, "-Wl") == 0)
+		sep = ",";
+	else if (strlen(flag) > 2)
+		sep = " ";
+
+	len = strlen(flag) + strlen(sep) + strlen(argument) + 1;
+	result = palloc(len);
+	snprintf(result, len, "%s%s%s", flag, sep, argument);
+
+	return result;
+}
+
+/*
+ * qsort comparator for DiffOption, by key and then value.
+ */
+static int
+diff_option_cmp(const void *a, const void *b)
+{
+	const DiffOption *oa = (const DiffOption *) a;
+	const DiffOption *ob = (const DiffOption *) b;
+	int			cmp;
+
+	cmp = strcmp(oa->key, ob->key);
+	if (cmp != 0)
+		return cmp;
+	return diff_value_cmp(oa->value, ob->value);
+}
+
+/*
+ * strcmp() that sorts NULL before any string.
+ */
+static int
+diff_value_cmp(const char *a, const char *b)
+{
+	if (a == NULL)
+		return b == NULL ? 0 : -1;
+	if (b == NULL)
+		return 1;
+	return strcmp(a, b);
+}
+
+/*
+ * Emit one row of pg_config_diff().
+ */
+static void
+diff_put(Tuplestorestate *tupstore, TupleDesc tupdesc,
+		 const char *item, const char *change,
+		 const char *oldvalue, const char *newvalue)
+{
+	Datum		values[4];
+	bool		nulls[4] = {false, false, false, false};
+
+	values[0] = CStringGetTextDatum(item);
+	values[1] = CStringGetTextDatum(change);
+	if (oldvalue)
+		values[2] = CStringGetTextDatum(oldvalue);
+	else
+		nulls[2] = true;
+	if (newvalue)
+		values[3] = CStringGetTextDatum(newvalue);
+	else
+		nulls[3] = true;
+
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+}
@@ -0,0 +1,330 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_controldata.c
+ *		Expose the contents of global/pg_control as a system view.
+ *
+ * Copyright (c) 2010, PostgreSQL Global Development Group
+ * ALL RIGHTS RESERVED;
+ *
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ *
+ * IN NO EVENT SHALL THE AUTHOR OR DISTRIBUTORS BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE AUTHOR OR DISTRIBUTORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHOR AND DISTRIBUTORS SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE AUTHOR AND DISTRIBUTORS HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ *
+ */
+
+#include "postgres.h"
+
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "access/xlog.h"
+#include "catalog/pg_control.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/pg_crc.h"
+#include "utils/timestamp.h"
+
+#include "pg_config_int.h"
+
+/*
+ * The control file is rewritten at every checkpoint, but polled much more
+ * often than that.  Keep the last verified copy, and re-read the file only
+ * when stat() says it has changed.  ControlFile always holds a copy that
+ * passed the CRC check once ControlFileValid is set; ControlFileStat
+ * describes the file it was last confirmed against.
+ */
+static ControlFileData ControlFile;
+static bool ControlFileValid = false;
+static struct stat ControlFileStat;
+static bool ControlFileStatValid = false;
+static time_t ControlFileReadTime;
+
+static void read_controlfile(void);
+static const char *wal_level_name(int wal_level);
+static void put_row(Tuplestorestate *tupstore, TupleDesc tupdesc,
+		const char *name, const char *setting);
+
+Datum pg_controldata(PG_FUNCTION_ARGS);
+
+/*
+ * pg_controldata() returns setof (name text, setting text)
+ *
+ * The same information the pg_controldata program prints, read from the
+ * running cluster's data directory.
+ */
+PG_FUNCTION_INFO_V1(pg_controldata);
+Datum
+pg_controldata(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate	   *tupstore;
+	TupleDesc			tupdesc;
+	char				buf[128];
+
+	tupstore = pgc_init_materialize(fcinfo, &tupdesc);
+
+	read_controlfile();
+
+	snprintf(buf, sizeof(buf), "%u", ControlFile.pg_control_version);
+	put_row(tupstore, tupdesc, "pg_control version number", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.catalog_version_no);
+	put_row(tupstore, tupdesc, "Catalog version number", buf);
+	snprintf(buf, sizeof(buf), UINT64_FORMAT, ControlFile.system_identifier);
+	put_row(tupstore, tupdesc, "Database system identifier", buf);
+	put_row(tupstore, tupdesc, "Database cluster state",
+			pgc_dbstate_name(ControlFile.state));
+	put_row(tupstore, tupdesc, "pg_control last modified",
+			timestamptz_to_str(time_t_to_timestamptz(ControlFile.time)));
+	snprintf(buf, sizeof(buf), "%X/%X",
+			 ControlFile.checkPoint.xlogid,
+			 ControlFile.checkPoint.xrecoff);
+	put_row(tupstore, tupdesc, "Latest checkpoint location", buf);
+	snprintf(buf, sizeof(buf), "%X/%X",
+			 ControlFile.prevCheckPoint.xlogid,
+			 ControlFile.prevCheckPoint.xrecoff);
+	put_row(tupstore, tupdesc, "Prior checkpoint location", buf);
+	snprintf(buf, sizeof(buf), "%X/%X",
+			 ControlFile.checkPointCopy.redo.xlogid,
+			 ControlFile.checkPointCopy.redo.xrecoff);
+	put_row(tupstore, tupdesc, "Latest checkpoint's REDO location", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.checkPointCopy.ThisTimeLineID);
+	put_row(tupstore, tupdesc, "Latest checkpoint's TimeLineID", buf);
+	snprintf(buf, sizeof(buf), "%u/%u",
+			 ControlFile.checkPointCopy.nextXidEpoch,
+			 ControlFile.checkPointCopy.nextXid);
+	put_row(tupstore, tupdesc, "Latest checkpoint's NextXID", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.checkPointCopy.nextOid);
+	put_row(tupstore, tupdesc, "Latest checkpoint's NextOID", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.checkPointCopy.nextMulti);
+	put_row(tupstore, tupdesc, "Latest checkpoint's NextMultiXactId", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.checkPointCopy.nextMultiOffset);
+	put_row(tupstore, tupdesc, "Latest checkpoint's NextMultiOffset", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.checkPointCopy.oldestXid);
+	put_row(tupstore, tupdesc, "Latest checkpoint's oldestXID", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.checkPointCopy.oldestXidDB);
+	put_row(tupstore, tupdesc, "Latest checkpoint's oldestXID's DB", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.checkPointCopy.oldestActiveXid);
+	put_row(tupstore, tupdesc, "Latest checkpoint's oldestActiveXID", buf);
+	put_row(tupstore, tupdesc, "Time of latest checkpoint",
+			timestamptz_to_str(time_t_to_timestamptz(ControlFile.checkPointCopy.time)));
+	snprintf(buf, sizeof(buf), "%X/%X",
+			 ControlFile.minRecoveryPoint.xlogid,
+			 ControlFile.minRecoveryPoint.xrecoff);
+	put_row(tupstore, tupdesc, "Minimum recovery ending location", buf);
+	snprintf(buf, sizeof(buf), "%X/%X",
+			 ControlFile.backupStartPoint.xlogid,
+			 ControlFile.backupStartPoint.xrecoff);
+	put_row(tupstore, tupdesc, "Backup start location", buf);
+	put_row(tupstore, tupdesc, "Current wal_level setting",
+			wal_level_name(ControlFile.wal_level));
+	snprintf(buf, sizeof(buf), "%d", ControlFile.MaxConnections);
+	put_row(tupstore, tupdesc, "Current max_connections setting", buf);
+	snprintf(buf, sizeof(buf), "%d", ControlFile.max_prepared_xacts);
+	put_row(tupstore, tupdesc, "Current max_prepared_xacts setting", buf);
+	snprintf(buf, sizeof(buf), "%d", ControlFile.max_locks_per_xact);
+	put_row(tupstore, tupdesc, "Current max_locks_per_xact setting", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.maxAlign);
+	put_row(tupstore, tupdesc, "Maximum data alignment", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.blcksz);
+	put_row(tupstore, tupdesc, "Database block size", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.relseg_size);
+	put_row(tupstore, tupdesc, "Blocks per segment of large relation", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.xlog_blcksz);
+	put_row(tupstore, tupdesc, "WAL block size", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.xlog_seg_size);
+	put_row(tupstore, tupdesc, "Bytes per WAL segment", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.nameDataLen);
+	put_row(tupstore, tupdesc, "Maximum length of identifiers", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.indexMaxKeys);
+	put_row(tupstore, tupdesc, "Maximum columns in an index", buf);
+	snprintf(buf, sizeof(buf), "%u", ControlFile.toast_max_chunk_size);
+	put_row(tupstore, tupdesc, "Maximum size of a TOAST chunk", buf);
+	put_row(tupstore, tupdesc, "Date/time type storage",
+			ControlFile.enableIntTimes ? "64-bit integers" : "floating-point numbers");
+	put_row(tupstore, tupdesc, "Float4 argument passing",
+			ControlFile.float4ByVal ? "by value" : "by reference");
+	put_row(tupstore, tupdesc, "Float8 argument passing",
+			ControlFile.float8ByVal ? "by value" : "by reference");
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Make sure ControlFile holds a verified copy of the current control file.
+ */
+static void
+read_controlfile(void)
+{
+	char		path[MAXPGPATH];
+	struct stat	st;
+	int			attempt;
+
+	snprintf(path, MAXPGPATH, "%s/global/pg_control", DataDir);
+
+	if (stat(path, &st) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+
+	/*
+	 * Reuse the cached copy if the file has not been replaced or rewritten
+	 * since we read it.  The mtime has only one-second resolution, so a copy
+	 * read during the same second as the last write is not trusted.
+	 */
+	if (ControlFileValid && ControlFileStatValid &&
+		st.st_dev == ControlFileStat.st_dev &&
+		st.st_ino == ControlFileStat.st_ino &&
+		st.st_size == ControlFileStat.st_size &&
+		st.st_mtime == ControlFileStat.st_mtime &&
+		ControlFileReadTime > st.st_mtime)
+		return;
+
+	ControlFileStatValid = false;
+
+	for (attempt = 1;; attempt++)
+	{
+		ControlFileData	newfile;
+		FILE		   *fp;
+		pg_crc32		crc;
+
+		if ((fp = AllocateFile(path, PG_BINARY_R)) == NULL)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", path)));
+		if (fread(&newfile, 1, sizeof(ControlFileData), fp) !=
+			sizeof(ControlFileData))
+		{
+			FreeFile(fp);
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", path)));
+		}
+		FreeFile(fp);
+
+		/*
+		 * Many re-reads find exactly the bytes we verified last time, for
+		 * instance when the mtime was too recent to trust.  Comparing them
+		 * is much cheaper than recomputing the CRC.
+		 */
+		if (ControlFileValid &&
+			memcmp(&newfile, &ControlFile, sizeof(ControlFileData)) == 0)
+			break;
+
+		if (newfile.pg_control_version != PG_CONTROL_VERSION)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("control file version %u does not match "
+							"the version %u this module was built with",
+							newfile.pg_control_version,
+							PG_CONTROL_VERSION)));
+
+		INIT_CRC32(crc);
+		COMP_CRC32(crc, (char *) &newfile,
+				   offsetof(ControlFileData, crc));
+		FIN_CRC32(crc);
+
+		if (EQ_CRC32(crc, newfile.crc))
+		{
+			memcpy(&ControlFile, &newfile, sizeof(ControlFileData));
+			break;
+		}
+
+		/*
+		 * The server rewrites the file in place, so we may have caught it
+		 * half-written.  Try again a couple of times before complaining.
+		 */
+		if (attempt >= 3)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("incorrect checksum in control file \"%s\"",
+							path)));
+		pg_usleep(1000L);
+	}
+
+	ControlFileStat = st;
+	ControlFileStatValid = true;
+	ControlFileReadTime = time(NULL);
+	ControlFileValid = true;
+}
+
+/*
+ * Return a verified copy of the current control file.
+ */
+const ControlFileData *
+pgc_controlfile(void)
+{
+	read_controlfile();
+	return &ControlFile;
+}
+
+/*
+ * The cluster state as pg_controldata prints it.
+ */
+const char *
+pgc_dbstate_name(DBState state)
+{
+	switch (state)
+	{
+		case DB_STARTUP:
+			return "starting up";
+		case DB_SHUTDOWNED:
+			return "shut down";
+		case DB_SHUTDOWNING:
+			return "shutting down";
+		case DB_IN_CRASH_RECOVERY:
+			return "in crash recovery";
+		case DB_IN_ARCHIVE_RECOVERY:
+			return "in archive recovery";
+		case DB_IN_PRODUCTION:
+			return "in production";
+	}
+	return "unrecognized status code";
+}
+
+/*
+ * The wal_level setting as pg_controldata prints it.
+ */
+static const char *
+wal_level_name(int wal_level)
+{
+	switch (wal_level)
+	{
+		case WAL_LEVEL_MINIMAL:
+			return "minimal";
+		case WAL_LEVEL_ARCHIVE:
+			return "archive";
+		case WAL_LEVEL_HOT_STANDBY:
+			return "hot_standby";
+	}
+	return "unrecognized wal_level";
+}
+
+static void
+put_row(Tuplestorestate *tupstore, TupleDesc tupdesc,
+		const char *name, const char *setting)
+{
+	Datum		values[2];
+	bool		nulls[2] = {false, false};
+
+	values[0] = CStringGetTextDatum(name);
+	values[1] = CStringGetTextDatum(setting);
+
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+}
@@ -3,6 +3,31 @@
 -- Adjust this setting to control where the objects get dropped.
 SET search_path = public;
 
+DROP VIEW pg_config_perf_lint;
+DROP VIEW pg_config_constants;
+DROP FUNCTION pg_config_constants();
 DROP VIEW pg_config;
 DROP FUNCTION pg_config();
+DROP FUNCTION pg_config(text);
 DROP FUNCTION pg_config_reset();
+DROP FUNCTION pg_config_fingerprint();
+DROP FUNCTION pg_config_fingerprint(text);
+DROP FUNCTION pg_config_json();
+DROP FUNCTION pg_config_configure_options();
+DROP FUNCTION pg_config_flags();
+DROP FUNCTION pg_config_diff(text, text, text);
+DROP FUNCTION pg_config_cpu_features();
+DROP FUNCTION pg_config_makefile_vars();
+DROP FUNCTION pg_config_binaries();
+DROP VIEW pg_config_elf;
+DROP FUNCTION pg_config_elf();
+DROP FUNCTION pg_config_loaded_libraries();
+DROP VIEW pg_config_library_loads;
+DROP FUNCTION pg_config_library_loads();
+DROP VIEW pg_config_extensions;
+DROP FUNCTION pg_config_extensions();
+DROP VIEW pg_config_history;
+DROP FUNCTION pg_config_history();
+DROP FUNCTION pg_config_history_sample();
+DROP VIEW pg_controldata;
+DROP FUNCTION pg_controldata();